@@ -0,0 +1,70 @@
+#pragma once
+
+#include <command/history.hpp>
+#include <cstddef>
+#include <managers/animation_manager.hpp>
+#include <rendering/frame.hpp>
+#include <string>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+/**
+ * Frames replaced, added or removed in one animation, stored as splices: the frames removed
+ * at an offset and the ones inserted there. Undo replays the splices backwards.
+ * The animation is looked up by name, an edit of an animation that is gone does nothing.
+ */
+class FramesEdit : public Edit {
+   public:
+    FramesEdit(const char* name, managers::AnimationManager& animation_manager,
+               std::string animation_name);
+
+    /// Replace `count` frames from `offset` by `frames` in the animation and record it
+    void splice(size_t offset, size_t count, std::vector<rendering::Frame> frames);
+
+    /// Whether no splice changed anything, such an edit is not worth recording
+    bool empty() const { return m_splices.empty(); }
+
+    const char* name() const override { return m_name; }
+    void undo() override;
+    void redo() override;
+    size_t num_bytes() const override;
+
+   private:
+    struct Splice {
+        size_t offset = 0;
+        std::vector<rendering::Frame> removed;
+        std::vector<rendering::Frame> inserted;
+    };
+
+    std::vector<rendering::Frame>* frames();
+
+   private:
+    const char* m_name;
+    managers::AnimationManager& m_animation_manager;
+    std::string m_animation_name;
+    std::vector<Splice> m_splices;
+};
+
+/// Every animation replaced at once (clear, load...): the animations before and after
+class AnimationsEdit : public Edit {
+   public:
+    /// Record the change from `before` to the animations the manager has now
+    AnimationsEdit(const char* name, managers::AnimationManager& animation_manager,
+                   managers::AnimationManager::Snapshot before);
+
+    const char* name() const override { return m_name; }
+    void undo() override { m_animation_manager.restore(m_before); }
+    void redo() override { m_animation_manager.restore(m_after); }
+    size_t num_bytes() const override;
+
+   private:
+    const char* m_name;
+    managers::AnimationManager& m_animation_manager;
+    managers::AnimationManager::Snapshot m_before;
+    managers::AnimationManager::Snapshot m_after;
+};
+
+}  // namespace commands
+}  // namespace piksy
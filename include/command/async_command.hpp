@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <command/command.hpp>
+#include <memory>
+
+namespace piksy {
+namespace commands {
+
+/// Flag shared between whoever may cancel a command and the command itself. Copies share the
+/// same flag.
+class CancellationToken {
+   public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { m_cancelled->store(true); }
+    bool is_cancelled() const { return m_cancelled->load(); }
+
+   private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+/// What a running command can see of its job: its cancellation and the progress it reports
+class CommandContext {
+   public:
+    explicit CommandContext(CancellationToken token = {}) : m_token(std::move(token)) {}
+
+    bool is_cancelled() const { return m_token.is_cancelled(); }
+
+    /// Between 0 and 1, read by the UI while the command runs
+    void set_progress(float progress) { m_progress.store(progress); }
+    float progress() const { return m_progress.load(); }
+
+   private:
+    CancellationToken m_token;
+    std::atomic<float> m_progress{0.0f};
+};
+
+/**
+ * Command split in three steps so its slow part can run on a worker thread:
+ * - `prepare()` on the main thread copies (or snapshots) everything the command reads,
+ * - `run()` does the actual work on a worker and must not touch the editor state,
+ * - `apply()` on the main thread writes the result back, skipped if the command was cancelled.
+ * `execute()` still runs the three steps in a row on the calling thread.
+ * If what the command read changed while it ran, the executor prepares and runs it again
+ * instead of applying a stale result.
+ */
+class AsyncCommand : public Command {
+   public:
+    void execute() final;
+
+    /// Shown in the status bar while the command is queued or running
+    virtual const char* name() const = 0;
+
+    /// Returns false when there is nothing to do, the command is then dropped
+    virtual bool prepare() { return true; }
+    virtual void run(CommandContext& context) = 0;
+    virtual void apply() {}
+
+    /// What `apply()` writes to. The executor never runs two commands with the same target at
+    /// once, they go one after the other. Null for a command that can run alongside anything.
+    virtual const void* target() const { return nullptr; }
+    /// Whether the input of the last `run()` changed since `prepare()`, checked before `apply()`
+    virtual bool is_stale() const { return false; }
+};
+
+}  // namespace commands
+}  // namespace piksy
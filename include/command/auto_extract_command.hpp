@@ -0,0 +1,49 @@
+#pragma once
+
+#include <command/async_command.hpp>
+#include <command/history.hpp>
+#include <extraction/labeller.hpp>
+#include <managers/animation_manager.hpp>
+#include <memory>
+#include <rendering/frame.hpp>
+#include <rendering/texture2D.hpp>
+#include <string>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+/**
+ * Command to split a whole sprite sheet into frames in one go.
+ * The texture is labelled in parallel bands of rows on the global thread pool, components
+ * crossing the band seams being merged afterwards, then the frames are sorted in reading order.
+ * The frames go to the animation named `animation_name`, looked up again once the labelling
+ * is done since it may have been removed meanwhile.
+ */
+class AutoExtractCommand : public AsyncCommand {
+   public:
+    AutoExtractCommand(std::shared_ptr<rendering::Texture2D> texture,
+                       managers::AnimationManager& animation_manager, std::string animation_name,
+                       bool append = false, const extraction::ExtractionSettings& settings = {},
+                       History* history = nullptr);
+
+    const char* name() const override { return "Auto extraction"; }
+
+    bool prepare() override;
+    void run(CommandContext& context) override;
+    void apply() override;
+
+   private:
+    std::shared_ptr<rendering::Texture2D> m_texture;
+    managers::AnimationManager& m_animation_manager;
+    std::string m_animation_name;
+    bool m_append;
+    extraction::ExtractionSettings m_settings;
+    History* m_history;
+
+    rendering::PixelSnapshot m_snapshot;
+    std::vector<rendering::Frame> m_frames;
+};
+
+}  // namespace commands
+}  // namespace piksy
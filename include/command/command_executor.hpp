@@ -0,0 +1,98 @@
+#pragma once
+
+#include <command/async_command.hpp>
+#include <command/command.hpp>
+#include <core/future.hpp>
+#include <core/thread_pool.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+enum class CommandPriority { LOW, NORMAL, HIGH };
+
+/// What the status bar shows of a queued or running command
+struct CommandStatus {
+    uint64_t id = 0;
+    std::string name;
+    float progress = 0.0f;
+    bool is_running = false;
+};
+
+/**
+ * Queue of commands run without blocking the frame. Async commands run on the thread pool, at
+ * most `max_running` at a time, and the highest priority goes first (then the oldest). Commands
+ * with the same target (see `AsyncCommand::target()`) run one after the other.
+ * Plain commands run on the main thread when their turn comes.
+ * Everything touching the editor state (`prepare()`, `apply()`, the callbacks) happens in
+ * `update()`, which the application calls once per frame.
+ */
+class CommandExecutor {
+   public:
+    explicit CommandExecutor(size_t max_running = 2,
+                             core::ThreadPool& pool = core::ThreadPool::global());
+    ~CommandExecutor();
+
+    /// Queue a command, `on_done` runs on the main thread once it is applied (not when it is
+    /// cancelled or fails). Returns an id for `cancel()`.
+    uint64_t submit(std::unique_ptr<Command> command,
+                    CommandPriority priority = CommandPriority::NORMAL,
+                    std::function<void()> on_done = {});
+
+    /// A queued command is dropped, a running one is told to stop and its result is discarded
+    void cancel(uint64_t id);
+    void cancel_all();
+
+    /// Apply the finished commands and start the next ones, main thread only
+    void update();
+
+    /// Drop the queued commands and wait for the running ones, their results are discarded
+    void shutdown();
+
+    bool is_busy() const { return !m_jobs.empty(); }
+
+    /// Running commands first, then the queue in the order it will run
+    std::vector<CommandStatus> status() const;
+
+   private:
+    struct Job {
+        uint64_t id = 0;
+        CommandPriority priority = CommandPriority::NORMAL;
+        std::shared_ptr<Command> command;
+        // Null for plain commands
+        AsyncCommand* async_command = nullptr;
+        std::shared_ptr<CommandContext> context;
+        CancellationToken token;
+        std::function<void()> on_done;
+
+        bool is_running = false;
+        core::Future<void> result;
+    };
+
+    bool prepare(Job& job);
+    void start(Job& job);
+    /// Apply a finished job, false if it had to run again
+    bool finish(Job& job);
+    /// Whether a command writing to the same target as `job` is running
+    bool is_target_busy(const Job& job) const;
+    size_t num_running() const;
+
+   private:
+    CommandExecutor(const CommandExecutor&) = delete;
+    CommandExecutor& operator=(const CommandExecutor&) = delete;
+
+    size_t m_max_running;
+    core::ThreadPool& m_pool;
+
+    // In submission order, the ones running included
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    uint64_t m_next_id = 1;
+};
+
+}  // namespace commands
+}  // namespace piksy
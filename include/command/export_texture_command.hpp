@@ -1,24 +1,30 @@
 #pragma once
 
-#include <command/command.hpp>
+#include <command/async_command.hpp>
 #include <core/state.hpp>
 #include <filesystem>
+#include <rendering/texture2D.hpp>
 
 namespace piksy {
 namespace commands {
 
 /**
  * Command to export the current Sprite's texture as a PNG file.
+ * The PNG is encoded from a snapshot of the pixels, so the texture can be edited meanwhile.
  */
-class ExportTextureCommand : public Command {
+class ExportTextureCommand : public AsyncCommand {
    public:
     ExportTextureCommand(core::State& state, std::filesystem::path output_path);
 
-    void execute() override;
+    const char* name() const override { return "Export"; }
+
+    bool prepare() override;
+    void run(CommandContext& context) override;
 
    private:
     core::State& m_state;
     std::filesystem::path m_output_path;
+    rendering::PixelSnapshot m_snapshot;
 };
 
 }  // namespace commands
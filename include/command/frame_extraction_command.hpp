@@ -5,8 +5,8 @@
 
 #include <command/command.hpp>
 #include <core/state.hpp>
+#include <extraction/labeller.hpp>
 #include <memory>
-#include <opencv2/opencv.hpp>
 #include <rendering/texture2D.hpp>
 #include <vector>
 
@@ -20,14 +20,14 @@ class FrameExtractionCommand : public Command {
     FrameExtractionCommand(const SDL_Rect& extraction_rect,
                            std::shared_ptr<rendering::Texture2D> texture,
                            std::vector<rendering::Frame>& out_frames, bool append = false,
-                           bool preview_mode = false);
+                           bool preview_mode = false,
+                           const extraction::ExtractionSettings& settings = {});
 
     virtual void execute() override;
 
-   private:
-    bool frames_are_equal(const rendering::Frame& a, const rendering::Frame& b, int tolerance = 2);
-
-    void sort_frames(std::vector<rendering::Frame>& frames);
+    /// Order frames in reading order: frames are clustered in rows by their top, then each row
+    /// goes left to right
+    static void sort_frames(std::vector<rendering::Frame>& frames);
 
    private:
     SDL_Rect m_extraction_rect;
@@ -35,6 +35,7 @@ class FrameExtractionCommand : public Command {
     std::vector<rendering::Frame>& m_out_frames;
     bool m_append;
     bool m_preview_mode;
+    extraction::ExtractionSettings m_settings;
 };
 }  // namespace commands
 }  // namespace piksy
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace piksy {
+namespace rendering {
+class Texture2D;
+}
+
+namespace commands {
+
+class TileStore;
+
+/// A change done to the project that can be reverted and done again
+class Edit {
+   public:
+    virtual ~Edit() = default;
+
+    /// Shown in the Edit menu, e.g. "Undo Color swap"
+    virtual const char* name() const = 0;
+
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+
+    /// Memory held by the edit, counted against the budget of the history
+    virtual size_t num_bytes() const = 0;
+
+    /// Texture whose pixels the edit writes, null if it writes none
+    virtual const rendering::Texture2D* texture() const { return nullptr; }
+};
+
+/**
+ * Undo/redo stacks of the edits done to the project.
+ * The history is bounded by a memory budget and a number of edits, the oldest edits are
+ * forgotten first. Recording a new edit drops everything that could be redone.
+ */
+class History {
+   public:
+    static constexpr size_t k_default_max_bytes = 256 * 1024 * 1024;
+    static constexpr size_t k_default_max_edits = 200;
+
+    explicit History(size_t max_bytes = k_default_max_bytes,
+                     size_t max_edits = k_default_max_edits);
+    ~History();
+
+    /// Record an edit that was just done
+    void push(std::unique_ptr<Edit> edit);
+
+    bool can_undo() const { return !m_undo.empty(); }
+    bool can_redo() const { return !m_redo.empty(); }
+
+    /// Next edit `undo()` / `redo()` would revert or do again, null if there is none
+    const Edit* next_undo() const { return can_undo() ? m_undo.back().get() : nullptr; }
+    const Edit* next_redo() const { return can_redo() ? m_redo.back().get() : nullptr; }
+
+    void undo();
+    void redo();
+    void clear();
+    /// Drop the edits of `texture`, e.g. once its pixels were replaced from disk and its
+    /// tiles would not match anymore. The edits of everything else are kept.
+    void forget(const rendering::Texture2D* texture);
+
+    size_t num_bytes() const { return m_num_bytes; }
+
+    /// Latest tiles recorded for a texture, shared by the pixel edits of that texture so two
+    /// consecutive edits of the same tile keep a single copy of it
+    std::shared_ptr<TileStore> tile_store(const rendering::Texture2D* texture);
+
+   private:
+    void trim();
+
+   private:
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    size_t m_max_bytes;
+    size_t m_max_edits;
+    size_t m_num_bytes = 0;
+
+    std::deque<std::unique_ptr<Edit>> m_undo;
+    std::vector<std::unique_ptr<Edit>> m_redo;
+
+    std::unordered_map<const rendering::Texture2D*, std::shared_ptr<TileStore>> m_tile_stores;
+};
+
+}  // namespace commands
+}  // namespace piksy
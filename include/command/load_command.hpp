@@ -1,6 +1,7 @@
 #pragma once
 
 #include <command/command.hpp>
+#include <command/history.hpp>
 #include <core/state.hpp>
 #include <filesystem>
 #include <istream>
@@ -17,7 +18,7 @@ class LoadCommand : public Command {
    public:
     LoadCommand(const fs::path& load_path, core::State& m_state,
                 managers::ResourceManager& resource_manager,
-                managers::AnimationManager& animation_manager);
+                managers::AnimationManager& animation_manager, History* history = nullptr);
 
     virtual void execute() override;
 
@@ -29,6 +30,8 @@ class LoadCommand : public Command {
     core::State& m_state;
     managers::ResourceManager& m_resource_manager;
     managers::AnimationManager& m_animation_manager;
+    // Records the animations replaced by the loaded ones, the texture is not part of it
+    History* m_history;
 };
 }  // namespace commands
 }  // namespace piksy
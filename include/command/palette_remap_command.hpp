@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SDL_pixels.h>
+
+#include <command/pixel_command.hpp>
+#include <cstdint>
+#include <memory>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+struct PaletteSwap {
+    SDL_Color from;
+    SDL_Color to;
+    uint8_t threshold = 1;
+};
+
+/**
+ * Command to recolor a texture with a whole palette (from -> to mapping) in a single pass,
+ * instead of one `SwapTextureCommand` per color.
+ * The swaps are applied simultaneously: a pixel takes the color of the first swap it matches
+ * and is never matched again against the following ones.
+ */
+class PaletteRemapCommand : public PixelCommand {
+   public:
+    PaletteRemapCommand(std::vector<PaletteSwap> palette,
+                        std::shared_ptr<rendering::Texture2D> texture, History* history = nullptr);
+
+    const char* name() const override { return "Palette remap"; }
+
+    bool prepare() override;
+
+   protected:
+    size_t edit(uint32_t* pixels, int width, int height, int pitch,
+                utils::pixels::PixelRect& out_changed) const override;
+    void on_applied(size_t num_changed) override;
+
+   private:
+    std::vector<PaletteSwap> m_palette;
+    std::vector<utils::pixels::PaletteEntry> m_entries;
+};
+
+}  // namespace commands
+}  // namespace piksy
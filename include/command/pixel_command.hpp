@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SDL_rect.h>
+
+#include <command/async_command.hpp>
+#include <command/history.hpp>
+#include <command/pixel_edit.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <rendering/texture2D.hpp>
+#include <utils/pixels.hpp>
+
+namespace piksy {
+namespace commands {
+
+/**
+ * Base of the commands rewriting the pixels of a whole texture.
+ * The edit runs in the background on a snapshot, a band of rows at a time so it can report its
+ * progress and stop early. Each band is edited in a scratch copy and only the tiles it changed
+ * are kept, they are written in place into the texture once done. If the texture was edited
+ * meanwhile, the executor runs the edit again on a new snapshot. Commands on the same texture
+ * run one at a time.
+ * With a history, the tiles before the edit are kept too so it can be undone.
+ */
+class PixelCommand : public AsyncCommand {
+   public:
+    PixelCommand(std::shared_ptr<rendering::Texture2D> texture, History* history);
+
+    bool prepare() override;
+    void run(CommandContext& context) override;
+    void apply() override;
+    const void* target() const override { return m_texture.get(); }
+    bool is_stale() const override;
+
+   protected:
+    /// Edit `height` rows of pixels, returns the number of pixels changed and their bounding
+    /// box in `out_changed`
+    virtual size_t edit(uint32_t* pixels, int width, int height, int pitch,
+                        utils::pixels::PixelRect& out_changed) const = 0;
+
+    /// Called on the main thread once the edited pixels are in the texture
+    virtual void on_applied(size_t num_changed) {}
+
+   protected:
+    std::shared_ptr<rendering::Texture2D> m_texture;
+    History* m_history;
+
+   private:
+    static constexpr int k_rows_per_band = 256;
+
+    rendering::PixelSnapshot m_snapshot;
+    bool m_has_result = false;
+    SDL_Rect m_changed{0, 0, 0, 0};
+    size_t m_num_changed = 0;
+    std::vector<PixelEdit::TileChange> m_tiles;
+};
+
+}  // namespace commands
+}  // namespace piksy
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <SDL_rect.h>
+
+#include <command/history.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <rendering/texture2D.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+/// Copy of the pixels of one tile of a texture, never modified once created
+struct Tile {
+    SDL_Rect rect{0, 0, 0, 0};
+    std::vector<uint32_t> pixels;  // rect.w pixels per row, no padding
+};
+
+using TileRef = std::shared_ptr<const Tile>;
+
+/// Content of the tiles of a texture at its latest version known to the history. The tile an
+/// edit leaves behind is the tile the next edit starts from, so both share it instead of
+/// each keeping its own copy.
+class TileStore {
+   public:
+    /// The tile at `index` when the texture is at `version`, null if unknown
+    TileRef find(uint64_t version, size_t index) const;
+
+    /// The texture went from `base_version` to `version` by writing `tiles`. The tiles known
+    /// for `base_version` are kept, since nothing else changed them.
+    void update(uint64_t base_version, uint64_t version,
+                const std::vector<std::pair<size_t, TileRef>>& tiles);
+
+   private:
+    uint64_t m_version = 0;
+    std::unordered_map<size_t, TileRef> m_tiles;
+};
+
+/**
+ * Pixel change of a texture, stored as the 64x64 tiles it changed before and after the change.
+ * Memory grows with the area edited, not with the size of the texture.
+ */
+class PixelEdit : public Edit {
+   public:
+    static constexpr int k_tile_size = 64;
+
+    struct TileChange {
+        size_t index = 0;
+        TileRef before;
+        TileRef after;
+    };
+
+    /// Tiles that differ between two versions of the same rows, only looking inside `changed`.
+    /// The rows start at `first_row` of the texture, a multiple of the tile size. Without
+    /// `with_before`, only the tiles after the change are copied. Only reads its arguments, so
+    /// it can run on a worker.
+    static std::vector<TileChange> diff(const rendering::PixelView& before,
+                                        const rendering::PixelView& after, const SDL_Rect& changed,
+                                        int first_row = 0, bool with_before = true);
+
+    /// Record `tiles`, the change that took `texture` from `base_version` to its current one
+    PixelEdit(const char* name, std::shared_ptr<rendering::Texture2D> texture,
+              std::shared_ptr<TileStore> store, std::vector<TileChange> tiles,
+              uint64_t base_version);
+
+    const char* name() const override { return m_name; }
+    void undo() override;
+    void redo() override;
+    size_t num_bytes() const override;
+    const rendering::Texture2D* texture() const override { return m_texture.get(); }
+
+    bool empty() const { return m_tiles.empty(); }
+
+   private:
+    void write(bool after);
+
+   private:
+    const char* m_name;
+    std::shared_ptr<rendering::Texture2D> m_texture;
+    std::shared_ptr<TileStore> m_store;
+    std::vector<TileChange> m_tiles;
+    // Versions of the texture before and after the change
+    uint64_t m_base_version;
+    uint64_t m_version;
+};
+
+}  // namespace commands
+}  // namespace piksy
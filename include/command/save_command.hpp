@@ -1,9 +1,9 @@
 #pragma once
 
-#include <command/command.hpp>
+#include <command/async_command.hpp>
 #include <core/state.hpp>
 #include <filesystem>
-#include <ostream>
+#include <utilities/json.hpp>
 
 #include "managers/animation_manager.hpp"
 
@@ -11,20 +11,28 @@ namespace fs = std::filesystem;
 
 namespace piksy {
 namespace commands {
-class SaveCommand : public Command {
+/**
+ * Command to save the animations and the sprite into the save file.
+ * The JSON is built on the main thread, only the writing to disk runs in the background.
+ */
+class SaveCommand : public AsyncCommand {
    public:
     SaveCommand(fs::path save_path, core::State& state,
                 managers::AnimationManager& animation_manager);
 
-    virtual void execute() override;
+    const char* name() const override { return "Save"; }
+
+    bool prepare() override;
+    void run(CommandContext& context) override;
 
    private:
-    void save(std::ostream& save_file_stream);
+    void save(const nlohmann::json& j);
 
    private:
     fs::path m_save_path;
     core::State& m_state;
     managers::AnimationManager& m_animation_manager;
+    nlohmann::json m_json;
 };
 }  // namespace commands
 }  // namespace piksy
@@ -3,25 +3,29 @@
 #include <SDL_rect.h>
 #include <SDL_render.h>
 
-#include <command/command.hpp>
+#include <command/pixel_command.hpp>
 #include <core/state.hpp>
 #include <cstdint>
 #include <memory>
-#include <opencv2/opencv.hpp>
 #include <rendering/texture2D.hpp>
 
 namespace piksy {
 namespace commands {
-class SwapTextureCommand : public Command {
+class SwapTextureCommand : public PixelCommand {
    public:
     SwapTextureCommand(const SDL_Color& m_from, const SDL_Color& m_to,
-                       std::shared_ptr<rendering::Texture2D> m_texture, uint8_t threshold = 1);
+                       std::shared_ptr<rendering::Texture2D> m_texture, uint8_t threshold = 1,
+                       History* history = nullptr);
 
-    virtual void execute() override;
+    const char* name() const override { return "Color swap"; }
+
+   protected:
+    size_t edit(uint32_t* pixels, int width, int height, int pitch,
+                utils::pixels::PixelRect& out_changed) const override;
+    void on_applied(size_t num_changed) override;
 
    private:
     SDL_Color m_from, m_to;
-    std::shared_ptr<rendering::Texture2D> m_texture;
     uint8_t m_threshold = 1;
 };
 }  // namespace commands
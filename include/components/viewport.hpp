@@ -4,9 +4,15 @@
 #include <SDL_pixels.h>
 #include <imgui.h>
 
+#include <command/animation_edit.hpp>
+#include <command/command_executor.hpp>
+#include <command/history.hpp>
+#include <command/palette_remap_command.hpp>
 #include <components/ui_component.hpp>
 #include <core/state.hpp>
+#include <extraction/preview_extractor.hpp>
 #include <managers/resource_manager.hpp>
+#include <rendering/color_swap_preview.hpp>
 #include <rendering/renderer.hpp>
 #include <vector>
 
@@ -20,7 +26,8 @@ class Viewport : public UIComponent {
    public:
     explicit Viewport(core::State& state, rendering::Renderer& renderer,
                       managers::ResourceManager& resource_manager,
-                      managers::AnimationManager& animation_manager);
+                      managers::AnimationManager& animation_manager,
+                      commands::CommandExecutor& command_executor, commands::History& history);
     ~Viewport();
 
     void update() override;
@@ -40,11 +47,12 @@ class Viewport : public UIComponent {
     void update_pan();
 
     void render_cursor_hud();
-    void render_placeholder_text();
+    void render_placeholder_text(const char* placeholder_text);
     void render_texture();
     void render_grid_background();
     void render_selection_rect();
     void render_frames() const;
+    void render_component_preview();
 
     // TODO: Move these to commands
     SDL_Color get_texture_pixel_color(int x, int y, const rendering::Sprite& sprite);
@@ -52,15 +60,41 @@ class Viewport : public UIComponent {
     void handle_click(float x, float y);
 
     void render_toolbar();
+    void render_color_swap_panel();
+    void render_extraction_panel();
+
+    void commit_color_swap();
+    /// Push a frame edit on the history, unless it changed nothing
+    void record(commands::FramesEdit&& edit);
+
+    SDL_Color replacement_color() const;
+    /// Move the picked color and its replacement to the palette
+    void add_palette_swap();
+    /// Recolor the texture with every swap of the palette in one command
+    void commit_palette();
+    void render_palette();
 
    private:
+    // Below these, the zoom (relative to the scale) and the pan (in texture pixels) snap to
+    // their target
+    static constexpr float k_zoom_epsilon = 1e-4f;
+    static constexpr float k_pan_epsilon = 1e-2f;
+
     rendering::Renderer& m_renderer;
     managers::ResourceManager& m_resource_manager;
     managers::AnimationManager& m_animation_manager;
+    commands::CommandExecutor& m_command_executor;
+    commands::History& m_history;
 
     SDL_Texture* m_render_texture = nullptr;
-    std::vector<rendering::Frame> m_preview_frames;
+    std::shared_ptr<const extraction::ExtractionPreview> m_preview;
     bool m_is_previewing = false;
+    // from -> to swaps applied together by the palette remap, kept across textures so the same
+    // palette can recolor several sheets
+    std::vector<commands::PaletteSwap> m_palette;
+    extraction::PreviewExtractor m_preview_extractor;
+
+    rendering::ColorSwapPreview m_color_swap_preview;
 
     ImVec2 m_viewport_size;
     SDL_Rect m_selection_rect;
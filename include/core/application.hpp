@@ -1,5 +1,7 @@
 #pragma once
 
+#include <command/command_executor.hpp>
+#include <command/history.hpp>
 #include <contexts/imgui_context.hpp>
 #include <contexts/sdl_context.hpp>
 #include <core/config.hpp>
@@ -41,12 +43,24 @@ class Application {
 
     void cleanup();
 
+    /// Whether something changes on screen without any input: a playing animation, a zoom or
+    /// pan in progress, a background job
+    bool is_animating() const;
+    /// Sleep until the next event when idle, see `AppConfig::idle_redraw`
+    void wait_for_events();
     void handle_events();
     void update();
     void render();
 
     void set_fancy_imgui_style();
 
+    void render_command_status();
+    void render_texture_cache();
+
+    void handle_shortcuts();
+    void undo();
+    void redo();
+
    private:
     Application &operator=(Application &&) = delete;
     Application &operator=(const Application &) = delete;
@@ -64,6 +78,13 @@ class Application {
     // TODO: move this into the state
     bool m_show_demo_window = true;
     bool m_is_running = true;
+    // Frames still drawn after the last event before the loop may sleep
+    static constexpr int k_settling_frames = 3;
+    int m_num_settling_frames = k_settling_frames;
+    // Pushed when a task is posted for the main thread or a watched file changed
+    Uint32 m_wakeup_event = static_cast<Uint32>(-1);
+    // Without a wakeup event nothing interrupts the sleep, the loop checks every so often
+    static constexpr int k_fallback_wait_ms = 100;
     ImVec4 m_clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
     contexts::SDLContext m_sdl_system;
@@ -73,6 +94,10 @@ class Application {
 
     Config m_config;
     State m_state;
+
+    commands::History m_history;
+    // Last so it is destroyed first, the running commands may still hold on to the state
+    commands::CommandExecutor m_command_executor;
 };
 }  // namespace core
 }  // namespace piksy
@@ -4,6 +4,8 @@
 #include <icons/IconsFontAwesome4.h>
 #include <imgui.h>
 
+#include <cstddef>
+#include <cstdlib>
 #include <string>
 
 #include "icons/IconsMaterialDesign.h"
@@ -284,8 +286,29 @@ struct ImGuiConfig {
     }
 };
 
+/// `$XDG_CACHE_HOME/piksy`, or `~/.cache/piksy` when it is not set. Empty if neither is known.
+inline std::string user_cache_directory() {
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    if (cache_home != nullptr && cache_home[0] != '\0') return std::string(cache_home) + "/piksy";
+
+    const char* home = std::getenv("HOME");
+    if (home != nullptr && home[0] != '\0') return std::string(home) + "/.cache/piksy";
+    return "";
+}
+
 struct AppConfig {
     std::string save_file = "./project.pkproj";
+    // Memory the unused textures may keep in the cache before the oldest are dropped
+    size_t texture_budget = 512 * 1024 * 1024;
+    // Decoded pixels of the opened textures, mapped instead of decoded on the next open.
+    // Empty to disable.
+    std::string pixel_cache_dir =
+        user_cache_directory().empty() ? "" : user_cache_directory() + "/pixels";
+    // Disk space of the pixel cache, the least recently used entries are removed past it
+    size_t pixel_cache_budget = size_t(4) * 1024 * 1024 * 1024;
+    // Without input, playing animation, zoom or pan in progress or background job, the main
+    // loop sleeps until an event comes instead of redrawing every frame
+    bool idle_redraw = true;
 };
 
 struct Config {
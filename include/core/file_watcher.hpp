@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace piksy {
+namespace core {
+
+/**
+ * Watches files from a background thread and reports the ones that changed. A file is only
+ * reported once it has been quiet for the debounce delay, so a tool writing it in several
+ * steps, or saving it twice in a row, triggers a single change. The main thread is woken up
+ * (see `ThreadPool::wake_main_thread()`) once a change is ready, an idle loop does not have to
+ * poll for it.
+ * Uses inotify on Linux, elsewhere the modification times are polled.
+ */
+class FileWatcher {
+   public:
+    explicit FileWatcher(std::chrono::milliseconds debounce = std::chrono::milliseconds(250));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    /// Start watching a file, `path` should be canonical
+    void watch(const std::string &path);
+    void unwatch(const std::string &path);
+
+    /// The watched files changed since the last call and quiet for the debounce delay
+    std::vector<std::string> poll_changes();
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    void on_changed(const std::string &path);
+    void wake_when_ready();
+#if defined(__linux__)
+    void read_events();
+#else
+    void poll_modification_times();
+#endif
+
+   private:
+    std::chrono::milliseconds m_debounce;
+
+    std::mutex m_mutex;
+    std::unordered_set<std::string> m_files;
+    // Time of the latest change of the files not reported yet
+    std::unordered_map<std::string, Clock::time_point> m_changes;
+    // The changes ready before it were announced to the main thread already
+    Clock::time_point m_last_wakeup;
+#if defined(__linux__)
+    int m_inotify_fd = -1;
+    // The parent directories are watched rather than the files: exporters often write a new
+    // file and rename it over the old one, which a watch on the file itself would miss
+    std::unordered_map<int, std::string> m_directories;
+    std::unordered_map<std::string, int> m_directory_watches;
+#else
+    std::unordered_map<std::string, long long> m_modification_times;
+#endif
+
+    std::atomic<bool> m_running{true};
+    std::thread m_thread;
+};
+
+}  // namespace core
+}  // namespace piksy
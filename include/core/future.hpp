@@ -0,0 +1,123 @@
+#pragma once
+
+#include <condition_variable>
+#include <core/thread_pool.hpp>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace piksy {
+namespace core {
+
+/// Result of a task started with `async()`. Copies share the same result.
+template <typename T>
+class Future {
+   public:
+    Future() = default;
+
+    bool valid() const { return m_state != nullptr; }
+    bool is_ready() const;
+
+    /// Wait for the result and return it, rethrows the exception of the task.
+    /// Blocks the caller: the main thread should use `then_on_main()` instead.
+    T get() const;
+
+    /// Run `fn(future)` on the main thread once the task is done, `future.get()` then returns
+    /// right away
+    template <typename Fn>
+    void then_on_main(Fn &&fn) const;
+
+   private:
+    template <typename Fn>
+    friend auto async(Fn &&fn, ThreadPool &pool);
+
+    struct State {
+        ThreadPool *pool = nullptr;
+        std::mutex mutex;
+        std::condition_variable ready_condition;
+        bool ready = false;
+        std::optional<std::conditional_t<std::is_void_v<T>, char, T>> value;
+        std::exception_ptr error;
+        // Run by the thread completing the task
+        std::vector<std::function<void()>> continuations;
+    };
+
+    explicit Future(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+    std::shared_ptr<State> m_state;
+};
+
+/// Run `fn()` on `pool` and return a future of its result
+template <typename Fn>
+auto async(Fn &&fn, ThreadPool &pool = ThreadPool::global()) {
+    using Result = std::invoke_result_t<std::decay_t<Fn>>;
+    using State = typename Future<Result>::State;
+
+    auto state = std::make_shared<State>();
+    state->pool = &pool;
+
+    pool.submit([state, fn = std::forward<Fn>(fn)]() mutable {
+        std::exception_ptr error;
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                fn();
+                state->value.emplace();
+            } else {
+                state->value.emplace(fn());
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::vector<std::function<void()>> continuations;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = error;
+            state->ready = true;
+            continuations.swap(state->continuations);
+        }
+        state->ready_condition.notify_all();
+        for (auto &continuation : continuations) continuation();
+    });
+
+    return Future<Result>(std::move(state));
+}
+
+template <typename T>
+bool Future<T>::is_ready() const {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->ready;
+}
+
+template <typename T>
+T Future<T>::get() const {
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->ready_condition.wait(lock, [&] { return m_state->ready; });
+    if (m_state->error) std::rethrow_exception(m_state->error);
+    if constexpr (!std::is_void_v<T>) return *m_state->value;
+}
+
+template <typename T>
+template <typename Fn>
+void Future<T>::then_on_main(Fn &&fn) const {
+    auto post = [future = *this, fn = std::forward<Fn>(fn)]() mutable {
+        future.m_state->pool->post_to_main(
+            [future, fn = std::move(fn)]() mutable { fn(future); });
+    };
+
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    if (!m_state->ready) {
+        m_state->continuations.push_back(std::move(post));
+        return;
+    }
+    lock.unlock();
+    post();
+}
+
+}  // namespace core
+}  // namespace piksy
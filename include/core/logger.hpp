@@ -27,10 +27,22 @@ class Logger {
         }
     }
 
+    /// Messages kept for the console, only call from the UI thread. Messages logged by the other
+    /// threads since the last call are moved in first.
     static const std::deque<std::pair<LogLevel, std::string>>& messages() {
-        return get().m_messages;
+        auto& logger = get();
+        std::lock_guard<std::mutex> lock(logger.m_mutex);
+        for (auto& message : logger.m_incoming) logger.m_messages.push_back(std::move(message));
+        logger.m_incoming.clear();
+        while (logger.m_messages.size() > k_max_messages) logger.m_messages.pop_front();
+        return logger.m_messages;
+    }
+    static void clear_messages() {
+        auto& logger = get();
+        std::lock_guard<std::mutex> lock(logger.m_mutex);
+        logger.m_incoming.clear();
+        logger.m_messages.clear();
     }
-    static void clear_messages() { get().m_messages.clear(); }
 
     template <typename... Args>
     static void trace(const std::string& format_str, Args&&... args) {
@@ -98,11 +110,9 @@ class Logger {
         std::string formatted_message = format_message(level, message);
         std::lock_guard<std::mutex> lock(m_mutex);
 
-        m_messages.push_back({level, formatted_message});
-
-        const size_t MAX_LOG_SIZE = 1000;
-        if (m_messages.size() > MAX_LOG_SIZE) {
-            m_messages.pop_front();
+        m_incoming.push_back({level, formatted_message});
+        if (m_incoming.size() > k_max_messages) {
+            m_incoming.pop_front();
         }
 
         if (m_config->enable_colors) {
@@ -195,10 +205,14 @@ class Logger {
     Logger& operator=(const Logger&) = delete;
     Logger& operator=(Logger&&) = delete;
 
+    static constexpr size_t k_max_messages = 1000;
+
     LoggerConfig* m_config = nullptr;
     std::mutex m_mutex;
     std::ofstream m_file_stream;
+    // Read by the UI thread only, the other threads go through m_incoming
     std::deque<std::pair<LogLevel, std::string>> m_messages;
+    std::deque<std::pair<LogLevel, std::string>> m_incoming;
 };
 
 }  // namespace piksy::core
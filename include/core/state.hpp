@@ -4,6 +4,7 @@
 #include <icons/IconsFontAwesome4.h>
 
 #include <core/logger.hpp>
+#include <extraction/labeller.hpp>
 #include <filesystem>
 #include <rendering/sprite.hpp>
 #include <string>
@@ -28,12 +29,20 @@ struct ZoomState {
     float current_scale = 1.0f;
     float target_scale = 1.0f;
     float zoom_speed = 0.1f;
+
+    /// Whether the scale reached its target, see `Viewport::update_zoom()`
+    bool is_settled() const { return current_scale == target_scale; }
 };
 
 struct PanState {
     ImVec2 current_offset;
     ImVec2 target_offset;
     float pan_speed = 0.7f;
+
+    /// Whether the offset reached its target, see `Viewport::update_pan()`
+    bool is_settled() const {
+        return current_offset.x == target_offset.x && current_offset.y == target_offset.y;
+    }
 };
 
 struct AnimationState {
@@ -52,6 +61,10 @@ struct ViewportState {
     int grid_cell_size = 20;
 };
 
+struct ColorSwapState {
+    int threshold = 1;
+};
+
 struct State {
     rendering::Sprite texture_sprite;
     float replacement_color[4]{0.0f, 0.0f, 0.0f, 0.0f};
@@ -62,6 +75,8 @@ struct State {
     PanState pan_state;
     AnimationState animation_state;
     ViewportState viewport_state;
+    ColorSwapState color_swap_state;
+    extraction::ExtractionSettings extraction_settings;
 
     float delta_time;
     float fps;
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace piksy {
+namespace core {
+
+/// Work-stealing pool of worker threads shared by the CPU heavy parts of the editor
+/// (pixel kernels, extraction, commands...), so they never run more threads than cores.
+/// Every worker has its own queue: the tasks a worker submits go to its own queue and it runs
+/// the newest first, idle workers steal the oldest tasks of the others. Tasks submitted from
+/// any other thread go through a shared queue.
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    /// Returns the process wide pool
+    static ThreadPool& global();
+
+    /// Number of worker threads
+    size_t size() const { return m_workers.size(); }
+
+    /// Queue a task to be run on one of the workers, or run it right away without workers.
+    /// An exception escaping the task is logged and dropped, use `async()` or a `TaskGroup` to
+    /// get it back.
+    void submit(std::function<void()> task);
+
+    /// Split [begin, end) into chunks of at least `grain` items and run `fn(chunk_begin,
+    /// chunk_end)` on the workers. The calling thread also processes chunks and the call only
+    /// returns once every chunk is done. The first exception thrown by a chunk is rethrown
+    /// then, the other chunks still run.
+    template <typename Fn>
+    void parallel_for(int begin, int end, int grain, Fn&& fn);
+
+    /// Cover a `width` x `height` image with square tiles of `tile_size` pixels and run
+    /// `fn(x, y, w, h)` on each of them, same rules as `parallel_for`
+    template <typename Fn>
+    void parallel_for_tiles(int width, int height, int tile_size, Fn&& fn);
+
+    /// Queue a task for the main thread, it runs on the next `run_main_thread_tasks()`
+    void post_to_main(std::function<void()> task);
+
+    /// Run the tasks posted for the main thread, called once per frame by the application
+    void run_main_thread_tasks();
+
+    /// Called from the posting thread every time a task is posted for the main thread, so a
+    /// main loop waiting for input wakes up to run it. Null to stop.
+    void set_main_thread_wakeup(std::function<void()> wakeup);
+
+    /// Wake the main loop up without posting a task, for results it polls every frame
+    void wake_main_thread();
+
+   private:
+    struct Queue {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    void worker_loop(size_t index);
+    bool pop_task(size_t index, std::function<void()>& task);
+
+   private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    std::vector<std::thread> m_workers;
+    // One queue per worker, then the shared queue
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<size_t> m_num_queued{0};
+
+    // Only guards the sleeping of the workers
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+
+    std::mutex m_main_mutex;
+    std::vector<std::function<void()>> m_main_tasks;
+    std::function<void()> m_main_wakeup;
+};
+
+/// Tasks run on the pool and waited for together. The waiting thread runs the tasks of the
+/// group nobody picked up yet, so waiting from a worker never idles it and never deadlocks.
+class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::global());
+    ~TaskGroup();
+
+    void run(std::function<void()> task);
+
+    /// Returns once every task is done, rethrows the first exception a task threw
+    void wait();
+
+   private:
+    // Shared with the pool, a helper may only get scheduled after the group is gone
+    struct Shared {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::deque<std::function<void()>> tasks;
+        size_t num_running = 0;
+        // First exception thrown by a task, rethrown by wait()
+        std::exception_ptr error;
+
+        bool run_one();
+    };
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ThreadPool& m_pool;
+    std::shared_ptr<Shared> m_shared;
+};
+
+template <typename Fn>
+void ThreadPool::parallel_for(int begin, int end, int grain, Fn&& fn) {
+    if (end <= begin) return;
+
+    grain = std::max(grain, 1);
+    const int num_items = end - begin;
+    const int max_chunks = static_cast<int>(size() + 1) * 4;
+    const int num_chunks = std::clamp((num_items + grain - 1) / grain, 1, max_chunks);
+
+    if (num_chunks == 1 || size() == 0) {
+        fn(begin, end);
+        return;
+    }
+
+    // The state is shared with the helper tasks: a helper may only get scheduled after every
+    // chunk has been processed and this call has returned. It then claims no chunk and never
+    // touches `fn`.
+    struct Shared {
+        std::atomic<int> next_chunk{0};
+        std::atomic<int> done_chunks{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto shared = std::make_shared<Shared>();
+    const int chunk_size = (num_items + num_chunks - 1) / num_chunks;
+
+    auto run_chunks = [shared, &fn, begin, end, chunk_size, num_chunks]() {
+        for (int chunk = shared->next_chunk++; chunk < num_chunks; chunk = shared->next_chunk++) {
+            int chunk_begin = begin + chunk * chunk_size;
+            int chunk_end = std::min(chunk_begin + chunk_size, end);
+            try {
+                if (chunk_begin < chunk_end) fn(chunk_begin, chunk_end);
+            } catch (...) {
+                // Still counted as done, or the caller would wait for it forever
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (!shared->error) shared->error = std::current_exception();
+            }
+
+            if (++shared->done_chunks == num_chunks) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->done.notify_all();
+            }
+        }
+    };
+
+    const size_t num_helpers = std::min(size(), static_cast<size_t>(num_chunks - 1));
+    for (size_t i = 0; i < num_helpers; ++i) {
+        submit(run_chunks);
+    }
+
+    run_chunks();
+
+    // Every chunk is claimed by now, only the ones still running on other threads are waited for
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&] { return shared->done_chunks.load() == num_chunks; });
+    if (shared->error) std::rethrow_exception(shared->error);
+}
+
+template <typename Fn>
+void ThreadPool::parallel_for_tiles(int width, int height, int tile_size, Fn&& fn) {
+    if (width <= 0 || height <= 0) return;
+
+    tile_size = std::max(tile_size, 1);
+    const int columns = (width + tile_size - 1) / tile_size;
+    const int rows = (height + tile_size - 1) / tile_size;
+    parallel_for(0, columns * rows, 1, [&](int tile_begin, int tile_end) {
+        for (int tile = tile_begin; tile < tile_end; ++tile) {
+            int x = (tile % columns) * tile_size, y = (tile / columns) * tile_size;
+            fn(x, y, std::min(tile_size, width - x), std::min(tile_size, height - y));
+        }
+    });
+}
+
+}  // namespace core
+}  // namespace piksy
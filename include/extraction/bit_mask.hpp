@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Binary mask packed 64 pixels per word: pixel `x` of a row is bit `x % 64` of word `x / 64`.
+/// Rows start on a word boundary and the bits past the width in their last word are always 0.
+class BitMask {
+   public:
+    BitMask() = default;
+    BitMask(int width, int height);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int words_per_row() const { return m_words_per_row; }
+    bool empty() const { return m_width <= 0 || m_height <= 0; }
+
+    uint64_t *row(int y) { return m_words.data() + static_cast<size_t>(y) * m_words_per_row; }
+    const uint64_t *row(int y) const {
+        return m_words.data() + static_cast<size_t>(y) * m_words_per_row;
+    }
+
+    bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    void set(int x, int y, bool value);
+
+    /// Number of set pixels
+    size_t count() const;
+
+    /// Grow every set pixel to a (2 * radius + 1) square, clipped to the mask
+    void dilate(int radius);
+
+    /// Keep only the pixels whose (2 * radius + 1) square is fully set. Pixels outside the mask
+    /// count as set, so the borders do not erode.
+    void erode(int radius);
+
+    /// Index of the first pixel of row `y`, starting from `x`, that is not `value`, or the width
+    /// if there is none. Skips 64 pixels per step.
+    int find_change(int x, int y, bool value) const;
+
+    /// Clear the bits past the width in the last word of row `y`
+    void clear_padding(int y);
+
+   private:
+    void dilate_rows(int radius);
+    void dilate_columns(int radius);
+    void invert();
+
+   private:
+    int m_width = 0, m_height = 0, m_words_per_row = 0;
+    std::vector<uint64_t> m_words;
+};
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SDL_rect.h>
+
+#include <cstdint>
+#include <extraction/bit_mask.hpp>
+#include <extraction/distance_field.hpp>
+#include <extraction/labeller.hpp>
+#include <rendering/frame.hpp>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Bounding boxes of the sprites of a whole texture.
+/// The texture is labelled once per pixels version and settings, the boxes are then bucketed in
+/// a uniform grid so a selection only visits the cells it covers. The thresholded mask is kept,
+/// so changing only the merge radius relabels from a distance field instead of the pixels.
+class ComponentIndex {
+   public:
+    ComponentIndex() = default;
+
+    /// Label `pixels` again unless the index already matches their version and `settings`.
+    /// Returns false if `is_cancelled` stopped the labelling, the index is left empty then.
+    bool update(const rendering::PixelSnapshot &pixels, const ExtractionSettings &settings,
+                const CancelCheck &is_cancelled = {});
+    void clear();
+
+    /// Replace `out_frames` by the components overlapping `rect`, clipped to it
+    void query(const SDL_Rect &rect, std::vector<rendering::Frame> &out_frames) const;
+
+    size_t size() const { return m_components.size(); }
+    const std::vector<SDL_Rect> &components() const { return m_components; }
+
+   private:
+    void build(const BitMask &mask, const CancelCheck &is_cancelled);
+
+   private:
+    static constexpr int k_cell_size = 128;
+
+    uint64_t m_version = 0;
+    ExtractionSettings m_settings;
+
+    // Thresholded pixels before dilation, and its distance field once the radius has changed
+    BitMask m_mask;
+    DistanceField m_field;
+
+    std::vector<SDL_Rect> m_components;
+
+    int m_columns = 0, m_rows = 0;
+    std::vector<std::vector<uint32_t>> m_cells;
+};
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <extraction/bit_mask.hpp>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Chessboard distance from every pixel to the closest set pixel of a mask, saturated past
+/// `k_max_distance`. Dilating the mask by a radius r is keeping the pixels at distance <= r, so
+/// once the field is built any radius up to `k_max_distance` is a single threshold pass.
+class DistanceField {
+   public:
+    static constexpr int k_max_distance = 32;
+
+    DistanceField() = default;
+    explicit DistanceField(const BitMask &mask);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    bool empty() const { return m_width <= 0 || m_height <= 0; }
+
+    /// Distance of pixel (x, y), `k_max_distance` + 1 when no set pixel is that close
+    int at(int x, int y) const { return m_distances[static_cast<size_t>(y) * m_width + x]; }
+
+    /// The mask dilated by `radius`, clamped to [0, k_max_distance]
+    BitMask threshold(int radius) const;
+
+   private:
+    uint8_t *row(int y) { return m_distances.data() + static_cast<size_t>(y) * m_width; }
+    const uint8_t *row(int y) const {
+        return m_distances.data() + static_cast<size_t>(y) * m_width;
+    }
+
+   private:
+    int m_width = 0, m_height = 0;
+    std::vector<uint8_t> m_distances;
+};
+
+}  // namespace extraction
+}  // namespace piksy
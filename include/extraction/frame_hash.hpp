@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SDL_rect.h>
+
+#include <cstdint>
+#include <rendering/frame.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Frames bucketed by position on a uniform grid, so finding a frame within a tolerance of
+/// another only looks at the few cells around it instead of every frame
+class FrameHash {
+   public:
+    /// Frames are similar when x, y, w and h all differ by at most `tolerance`
+    explicit FrameHash(int tolerance = 2);
+
+    void insert(const rendering::Frame &frame);
+    void insert(const std::vector<rendering::Frame> &frames);
+
+    bool contains_similar(const rendering::Frame &frame) const;
+
+   private:
+    uint64_t key(int column, int row) const;
+    int cell(int coordinate) const;
+
+   private:
+    int m_tolerance;
+    int m_cell_size;
+    std::unordered_map<uint64_t, std::vector<SDL_Rect>> m_cells;
+};
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <extraction/bit_mask.hpp>
+#include <functional>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Parameters of the binarize and dilate pass splitting a sheet into sprites.
+/// `dilation` is the merge radius: sprite parts closer than 2 * dilation + 1 pixels are merged.
+struct ExtractionSettings {
+    int threshold = 1;
+    int dilation = 2;
+
+    bool operator==(const ExtractionSettings &other) const {
+        return threshold == other.threshold && dilation == other.dilation;
+    }
+    bool operator!=(const ExtractionSettings &other) const { return !(*this == other); }
+};
+
+/// Polled by the labelling passes between two row blocks, returns true to abandon the work.
+/// An abandoned pass returns an empty or partial result, the caller has to drop it.
+using CancelCheck = std::function<bool()>;
+
+/// A sprite found by the labeller, `num_pixels` counts the pixels of the dilated mask
+struct Component {
+    int x = 0, y = 0, w = 0, h = 0;
+    size_t num_pixels = 0;
+};
+
+/// Find the sprites of `pixels` without building any contour.
+/// Pixels brighter than `settings.threshold` go in a bit packed mask dilated by a square of
+/// 2 * `settings.dilation` + 1 pixels, then the mask is split in runs labelled with union-find
+/// (8-connected foreground, 4-connected background). Components sitting inside the hole of
+/// another one are dropped. The result matches the cvtColor/threshold/dilate/findContours
+/// (RETR_EXTERNAL) pipeline the extraction used to run, boxes and order included.
+std::vector<Component> label_components(const rendering::PixelView &pixels,
+                                        const ExtractionSettings &settings,
+                                        const CancelCheck &is_cancelled = {});
+
+/// Mask of the pixels brighter than `threshold`, before any dilation
+BitMask threshold_mask(const rendering::PixelView &pixels, int threshold,
+                       const CancelCheck &is_cancelled = {});
+
+/// The labelling step of label_components on a mask already thresholded and dilated
+std::vector<Component> label_mask(const BitMask &mask, const CancelCheck &is_cancelled = {});
+
+}  // namespace extraction
+}  // namespace piksy
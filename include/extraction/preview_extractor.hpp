@@ -0,0 +1,82 @@
+#pragma once
+
+#include <SDL_rect.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <extraction/component_index.hpp>
+#include <extraction/labeller.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <rendering/frame.hpp>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace extraction {
+
+/// Frames found in a selection, as published by the PreviewExtractor
+struct ExtractionPreview {
+    uint64_t request = 0;  // Id of the request this answers
+    uint64_t version = 0;  // Version of the pixels it was computed from
+    SDL_Rect rect{0, 0, 0, 0};
+    std::vector<rendering::Frame> frames;
+    // Sprites of the whole texture with the same settings
+    size_t num_components = 0;
+};
+
+/// Computes the extraction previews on the thread pool so the UI never waits on a labelling.
+/// Requests are coalesced: only the newest one is computed, the older ones still waiting are
+/// dropped and a running one is abandoned between two row blocks of its labelling. Results are
+/// published as an immutable snapshot swapped atomically.
+class PreviewExtractor {
+   public:
+    PreviewExtractor() = default;
+    ~PreviewExtractor();
+
+    /// Ask for the frames of `pixels` inside `rect`, does nothing if it is the last request
+    void request(const rendering::PixelSnapshot &pixels, const SDL_Rect &rect,
+                 const ExtractionSettings &settings);
+
+    /// Latest finished preview or null, never blocks
+    std::shared_ptr<const ExtractionPreview> result() const;
+
+    /// Whether the latest result answers the latest request
+    bool is_up_to_date() const;
+
+    /// Drop the pending requests and the published result
+    void cancel();
+
+   private:
+    struct Request {
+        uint64_t id = 0;
+        rendering::PixelSnapshot pixels;
+        SDL_Rect rect{0, 0, 0, 0};
+        ExtractionSettings settings;
+    };
+
+    void run();
+    bool is_stale(uint64_t id) const { return id != m_latest.load(); }
+
+   private:
+    PreviewExtractor(const PreviewExtractor &) = delete;
+    PreviewExtractor &operator=(const PreviewExtractor &) = delete;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_idle;
+    std::optional<Request> m_pending;
+    bool m_running = false;
+    // Last request accepted, to skip the ones asked again every frame
+    std::optional<Request> m_last;
+
+    std::atomic<uint64_t> m_latest{0};
+    std::shared_ptr<const ExtractionPreview> m_result;
+
+    // Only touched by the job currently running
+    ComponentIndex m_index;
+};
+
+}  // namespace extraction
+}  // namespace piksy
@@ -2,6 +2,8 @@
 
 #include <SDL_events.h>
 
+#include <command/command_executor.hpp>
+#include <command/history.hpp>
 #include <components/project.hpp>
 #include <components/viewport.hpp>
 #include <layers/layer.hpp>
@@ -18,7 +20,8 @@ class EditorLayer : public Layer {
    public:
     EditorLayer(rendering::Renderer& renderer, core::State& state,
                 managers::ResourceManager& resource_manager,
-                managers::AnimationManager& animation_manager);
+                managers::AnimationManager& animation_manager,
+                commands::CommandExecutor& command_executor, commands::History& history);
 
     void on_attach() override;
     void on_detach() override;
@@ -30,6 +33,8 @@ class EditorLayer : public Layer {
     rendering::Renderer& m_renderer;
     managers::ResourceManager& m_resource_manager;
     managers::AnimationManager& m_animation_manager;
+    commands::CommandExecutor& m_command_executor;
+    commands::History& m_history;
 
     std::unique_ptr<components::Viewport> m_viewport;
     std::unique_ptr<components::Console> m_console;
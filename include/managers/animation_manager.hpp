@@ -2,6 +2,8 @@
 
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "core/logger.hpp"
 #include "rendering/animation.hpp"
@@ -10,6 +12,12 @@ namespace piksy {
 namespace managers {
 class AnimationManager {
    public:
+    /// Names and frames of every animation, enough to bring them all back with `restore()`
+    struct Snapshot {
+        std::vector<std::pair<std::string, std::vector<rendering::Frame>>> animations;
+        std::string current_animation;
+    };
+
     AnimationManager() = default;
 
     /// Create a new default animation
@@ -38,6 +46,10 @@ class AnimationManager {
     /// Clears all the animations
     void clear();
 
+    Snapshot snapshot() const;
+    /// Replace every animation by the ones of the snapshot
+    void restore(const Snapshot& snapshot);
+
    public:
     /// Returns the animations
     const std::unordered_map<std::string, rendering::Animation>& animations() const {
@@ -47,6 +59,12 @@ class AnimationManager {
     /// Returns the current animation
     rendering::Animation* current_animation() { return m_current_animation; }
 
+    /// Returns the animation with the given name, or null
+    rendering::Animation* animation(const std::string& name);
+
+    /// Returns the name of the current animation, empty if there is none
+    std::string current_animation_name() const;
+
    private:
     rendering::Animation* m_current_animation = nullptr;
     std::unordered_map<std::string, rendering::Animation> m_animations;
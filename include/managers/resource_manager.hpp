@@ -2,9 +2,20 @@
 
 #include <SDL_render.h>
 
+#include <core/file_watcher.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
 #include <rendering/font.hpp>
+#include <rendering/pixel_cache.hpp>
 #include <rendering/texture2D.hpp>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "rendering/renderer.hpp"
 
@@ -12,20 +23,98 @@ namespace piksy {
 namespace managers {
 class ResourceManager {
    public:
+    struct TextureInfo {
+        std::string path;
+        size_t num_bytes = 0;
+        bool in_use = false;
+    };
+
     explicit ResourceManager(rendering::Renderer &renderer) : m_renderer(renderer) {}
 
     void load_texture(const std::string &texture_path);
+    /// Returns the texture right away. A texture seen for the first time is read, hashed and
+    /// decoded on the thread pool and only uploaded on the render thread: until then the
+    /// texture is a placeholder without pixels (see `Texture2D::is_loaded()`). Throws if the
+    /// file does not exist.
+    /// Paths are resolved first, a relative path or a symlink gets the texture of the file it
+    /// points to. A copy of a file already loaded gets its own texture sharing the pixels of
+    /// the other one, so it costs no decode.
     std::shared_ptr<rendering::Texture2D> get_texture(const std::string &texture_path);
 
+    /// Reload the textures whose file changed on disk, called once per frame. The new pixels
+    /// are decoded in the background and swapped into the same `Texture2D`, so every sprite
+    /// using it follows.
+    void update();
+
+    /// Called once the pixels of a texture were replaced by a reload. A texture with unsaved
+    /// edits is not reloaded, its edits win over the file until they are all undone.
+    void set_on_texture_reloaded(std::function<void(const rendering::Texture2D *)> callback) {
+        m_on_texture_reloaded = std::move(callback);
+    }
+
+    /// Number of textures still being decoded
+    size_t num_pending_textures() const { return m_num_pending_textures; }
+
+    /// Keep the decoded pixels of the textures in `directory`, so they are mapped instead of
+    /// decoded the next time. The cache holds at most `budget` bytes, an empty directory
+    /// disables it.
+    void set_pixel_cache(const std::string &directory, size_t budget);
+
+    /// Past this many bytes, the least recently used textures nothing else holds are dropped
+    /// from the cache. They are decoded again by the next `get_texture()`.
+    void set_texture_budget(size_t num_bytes);
+    size_t texture_budget() const { return m_texture_budget; }
+    /// Memory held by the cached textures
+    size_t num_texture_bytes() const;
+    /// The cached textures, most recently used first
+    std::vector<TextureInfo> texture_infos() const;
+
     void load_font(const std::string &font_path);
     std::shared_ptr<rendering::Font> get_font(const std::string &font_path);
 
     void cleanup();
 
+   private:
+    struct TextureEntry {
+        std::shared_ptr<rendering::Texture2D> texture;
+        std::list<std::string>::iterator lru;
+        // Of the file content the pixels come from, 0 until the file is read
+        uint64_t hash = 0;
+    };
+
+    /// Second step of a load, once the file is read: take the pixels of a texture with the
+    /// same content or decode them on the thread pool
+    void load_content(const std::string &path, const std::weak_ptr<rendering::Texture2D> &target,
+                      uint64_t hash, std::shared_ptr<const std::vector<uint8_t>> bytes);
+    /// A loaded and unedited texture whose pixels come from this content, null if none
+    std::shared_ptr<rendering::Texture2D> find_content(uint64_t hash) const;
+    void fail_loading(const std::string &path, const std::shared_ptr<rendering::Texture2D> &texture,
+                      const std::exception &error);
+    void reload_texture(const std::string &path);
+    /// Keep the reload of an edited texture for when its edits are undone
+    void defer_reload(const std::string &path);
+    /// Write the pixels of a texture decoded from `path` to the pixel cache, on the thread pool
+    void store_pixels(const std::string &path, uint64_t hash, const rendering::Image &image);
+    void evict_textures();
+    void erase_texture(std::unordered_map<std::string, TextureEntry>::iterator it);
+    static bool is_in_use(const TextureEntry &entry);
+
    private:
     rendering::Renderer &m_renderer;
-    std::unordered_map<std::string, std::shared_ptr<rendering::Texture2D>> m_textures;
+    // Keyed by canonical path
+    std::unordered_map<std::string, TextureEntry> m_textures;
+    // Paths of the cached textures, most recently used first
+    std::list<std::string> m_texture_lru;
     std::unordered_map<std::string, std::shared_ptr<rendering::Font>> m_fonts;
+    size_t m_num_pending_textures = 0;
+    // Shared with the decoding jobs, null when disabled
+    std::shared_ptr<const rendering::PixelCache> m_pixel_cache;
+    // Every path in m_textures
+    core::FileWatcher m_file_watcher;
+    // Changed on disk while their texture had unsaved edits
+    std::unordered_set<std::string> m_deferred_reloads;
+    size_t m_texture_budget = 512 * 1024 * 1024;
+    std::function<void(const rendering::Texture2D *)> m_on_texture_reloaded;
 };
 }  // namespace managers
 }  // namespace piksy
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SDL_pixels.h>
+#include <SDL_render.h>
+
+#include <cstdint>
+#include <memory>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace rendering {
+
+/// Live preview of a color swap threshold.
+/// Picking a color computes once the distance of every pixel of the texture to it, moving the
+/// threshold afterwards only re-thresholds that buffer into an overlay, split into tiles like
+/// the texture itself.
+class ColorSwapPreview {
+   public:
+    ColorSwapPreview() = default;
+
+    /// Build the distance buffer of the texture pixels to `color`
+    void pick(std::shared_ptr<Texture2D> texture, const SDL_Color& color);
+    void clear();
+
+    bool is_active() const { return m_texture != nullptr; }
+    const std::shared_ptr<Texture2D>& texture() const { return m_texture; }
+    const SDL_Color& color() const { return m_color; }
+
+    /// Refresh the overlay for `threshold`, no-op if it did not change since the last call
+    void update(SDL_Renderer* renderer, uint8_t threshold);
+
+    /// Covers the whole texture, empty until the first `update()`
+    const std::vector<TextureTile>& overlay() const { return m_overlay; }
+    size_t num_affected() const { return m_num_affected; }
+
+   private:
+    std::shared_ptr<Texture2D> m_texture;
+    SDL_Color m_color{};
+    std::vector<uint16_t> m_distances;
+
+    std::vector<TextureTile> m_overlay;
+    // CPU copy of the overlay, uploaded to the tiles
+    std::vector<uint32_t> m_overlay_pixels;
+    int m_overlay_threshold = -1;
+    size_t m_num_affected = 0;
+};
+
+}  // namespace rendering
+}  // namespace piksy
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <rendering/texture2D.hpp>
+#include <string>
+
+namespace piksy {
+namespace rendering {
+
+/**
+ * On-disk cache of decoded pixels, one raw RGBA8888 file per image file, so reopening a sheet
+ * maps its pixels instead of decoding it again. An entry records the modification time, size
+ * and content hash of the image it was decoded from and is ignored once the image changes.
+ * Past the byte budget, the least recently mapped or stored entries are removed.
+ * Every method only touches the disk, they can run on any thread.
+ */
+class PixelCache {
+   public:
+    PixelCache(std::string directory, size_t budget);
+
+    /// Content hash of the image at `path` if its entry is still valid, only reads the header
+    std::optional<uint64_t> find(const std::string &path) const;
+
+    /// The cached pixels of `path`, mapped in memory: pages are read on first access and the
+    /// pixels can be edited without touching the file. Throws if the entry is missing or stale.
+    Image map(const std::string &path, uint64_t hash) const;
+
+    /// Write the entry of `path`, then remove the oldest entries past the budget. The cache is
+    /// only a shortcut, failures are logged and ignored.
+    void store(const std::string &path, uint64_t hash, const Image &image) const;
+
+   private:
+    std::string entry_path(const std::string &path) const;
+    void trim() const;
+
+   private:
+    std::string m_directory;
+    size_t m_budget;
+};
+
+}  // namespace rendering
+}  // namespace piksy
@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <rendering/texture2D.hpp>
+#include <vector>
 
 namespace piksy {
 namespace rendering {
@@ -23,6 +24,10 @@ class Sprite {
     void set_texture(std::shared_ptr<Texture2D> texture);
     std::shared_ptr<Texture2D> texture() const;
 
+    /// Takes the size of the texture once it is loaded or after a reload resized it, called
+    /// every frame
+    void update();
+
     int x() const;
     int y() const;
     int width() const;
@@ -36,10 +41,21 @@ class Sprite {
     void render(SDL_Renderer *renderer, float scale = 1.0f, float offset_x = 0.0f,
                 int offset_y = 0.0f) const;
 
+    /// Draw the tiles of `overlay` (same size as the sprite texture) on top of the sprite
+    void render_overlay(SDL_Renderer *renderer, const std::vector<TextureTile> &overlay,
+                        float scale = 1.0f, float offset_x = 0.0f, int offset_y = 0.0f) const;
+
+   private:
+    SDL_Rect screen_rect(float scale, float offset_x, int offset_y) const;
+    void fit_texture();
+
    private:
     std::shared_ptr<Texture2D> m_texture;
     SDL_Rect m_rect, m_frame_rect;
     bool m_selected = false;
+    // Size of the texture when the sprite was fitted to it, a texture still loading has none
+    // and a reloaded one may have changed
+    int m_fitted_width = 0, m_fitted_height = 0;
 };
 }  // namespace rendering
 }  // namespace piksy
@@ -2,17 +2,124 @@
 
 #include <SDL_render.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace piksy {
 namespace rendering {
-class Texture2D {
+
+/// Read-only view over RGBA8888 pixels (red in the most significant byte)
+struct PixelView {
+    const uint32_t *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int pitch = 0;  // In bytes
+
+    bool empty() const { return pixels == nullptr || width <= 0 || height <= 0; }
+
+    const uint32_t *row(int y) const {
+        return reinterpret_cast<const uint32_t *>(reinterpret_cast<const uint8_t *>(pixels) +
+                                                  static_cast<size_t>(y) * pitch);
+    }
+
+    uint32_t at(int x, int y) const { return row(y)[x]; }
+
+    /// View over a sub rectangle, which must lie inside this view
+    PixelView crop(int x, int y, int w, int h) const { return {row(y) + x, w, h, pitch}; }
+};
+
+/// Pixels of a texture at one version. The buffer stays alive, and is never written again, even
+/// if the texture reloads or gets edited meanwhile, so a background job can keep reading it.
+struct PixelSnapshot {
+    std::shared_ptr<const uint32_t> buffer;
+    PixelView pixels;
+    uint64_t version = 0;
+
+    bool empty() const { return pixels.empty(); }
+};
+
+/// Pixels decoded from an image file, always RGBA8888. Not tied to a renderer, so it can be
+/// decoded on any thread.
+struct Image {
+    std::shared_ptr<uint32_t> pixels;
+    int width = 0;
+    int height = 0;
+    int pitch = 0;  // In bytes
+};
+
+/// One SDL texture holding the `rect` region of an image
+struct TextureTile {
+    SDL_Rect rect{0, 0, 0, 0};
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr,
+                                                                        SDL_DestroyTexture};
+};
+
+/// Textures covering a `width` x `height` image. A renderer caps the size of its textures,
+/// past it the image is covered by a grid of them. Throws if a texture cannot be created.
+std::vector<TextureTile> create_tiles(SDL_Renderer *renderer, int width, int height);
+
+/// Upload the `rect` region of the pixels to the tiles it overlaps
+void upload_tiles(const std::vector<TextureTile> &tiles, const uint32_t *pixels, int pitch,
+                  const SDL_Rect &rect);
+
+/// Draw the `source` region of the image covered by `tiles` to `destination`, only copying
+/// what lands in the viewport of the renderer
+void draw_tiles(SDL_Renderer *renderer, const std::vector<TextureTile> &tiles,
+                const SDL_Rect &source, const SDL_Rect &destination);
+
+/// The part of `source` that lands in the viewport of the renderer once `source` is drawn to
+/// `destination`, false if none does. Zoomed in, that is a few pixels of a large source.
+bool visible_source(SDL_Renderer *renderer, const SDL_Rect &source, const SDL_Rect &destination,
+                    SDL_Rect *visible);
+
+/// Where the `part` of `source` lands once `source` is drawn to `destination`. Every edge goes
+/// through the same mapping, so neighbouring parts meet exactly.
+SDL_Rect map_to_destination(const SDL_Rect &source, const SDL_Rect &destination,
+                            const SDL_Rect &part);
+
+class Texture2D : public std::enable_shared_from_this<Texture2D> {
    public:
+    /// Wraps an existing texture, its pixels are not mirrored on the CPU
     explicit Texture2D(SDL_Texture *texture);
     Texture2D(SDL_Renderer *renderer, const std::string &texture_path);
+    /// Placeholder for a texture decoded in the background: no pixels and no size until
+    /// `set_image()` is called
+    explicit Texture2D(const std::string &texture_path);
+
+    /// Decode an image file, throws if it cannot be read. Safe to call from any thread.
+    static Image decode(const std::string &path);
+    /// Decode the content of an image file already in memory
+    static Image decode(const void *data, size_t size);
+
+    /// Take the decoded pixels and upload them to a new SDL texture, render thread only
+    void set_image(SDL_Renderer *renderer, Image image);
+
+    /// False for a placeholder whose image is not there yet
+    bool is_loaded() const;
+    /// Whether the pixels were edited since the image was loaded
+    bool is_modified() const;
+
+    /// Memory held by the CPU pixels and the SDL texture
+    size_t num_bytes() const;
+
+    /// The SDL textures covering the image. Renderers cap the size of a texture, an image
+    /// larger than that is split into a grid of tiles that each fit.
+    const std::vector<TextureTile> &tiles() const;
+
+    /// Draw the `source` region of the image to `destination`. Only the part of `source` that
+    /// lands in the viewport of the renderer is copied. Drawn at half its size or less, the
+    /// image is sampled from the matching mip level instead, once it is built.
+    void draw(SDL_Renderer *renderer, const SDL_Rect &source, const SDL_Rect &destination);
+
+    /// Build the mip levels (half, quarter... of the size, box filtered) from the current
+    /// pixels on the thread pool, they are uploaded on the render thread once done.
+    /// Started by `set_image()`, and by `draw()` when the levels are older than an edit.
+    /// Only for a texture owned by a shared_ptr.
+    void build_mips(SDL_Renderer *renderer);
 
-    SDL_Texture *get() const;
     int width() const;
     int height() const;
     const std::string &path() const;
@@ -20,15 +127,72 @@ class Texture2D {
     void set_path(const std::string &path);
     void reload(SDL_Renderer *renderer);
 
+    /// The CPU copy of the pixels, always RGBA8888. This is the source of truth, the SDL texture
+    /// only mirrors it and is never read back.
+    PixelView pixels() const;
+
+    /// Writable access to the CPU pixels, call `mark_dirty()` with the edited region once done.
+    /// The pixels are copied first if a snapshot still holds them.
+    uint32_t *mutable_pixels();
+
+    /// Share the current pixels with a background job
+    PixelSnapshot snapshot() const;
+
+    /// The current pixels as an image for `set_image()` of another texture with the same
+    /// content. Both then share the buffer, the first one edited copies it.
+    Image image() const;
+
+    /// Flag a region of the CPU pixels as edited, it is uploaded on the next `flush()`
+    void mark_dirty(const SDL_Rect &rect);
+    /// Flag the whole texture as edited
+    void mark_dirty();
+    bool is_dirty() const;
+
+    /// Changed on every load and edit, lets data derived from the pixels know it is stale.
+    /// Versions are unique across all textures, so a version alone identifies a set of pixels.
+    uint64_t version() const;
+    /// The pixels are back to exactly what they were at `version`, e.g. an undo wrote them
+    /// back. Data derived from that version is valid again, and undoing every edit makes the
+    /// texture unmodified.
+    void restore_version(uint64_t version);
+
+    /// Merge the dirty regions and upload only those to the SDL texture, called once per frame
+    /// before the texture is drawn
+    void flush();
+
    private:
+    struct MipLevel {
+        int width = 0, height = 0;
+        std::vector<TextureTile> tiles;
+    };
+
     void load(SDL_Renderer *renderer);
+    void allocate_pixels();
+    /// The mip level to sample when drawing at `scale`, 0 being the image itself
+    int mip_level(SDL_Renderer *renderer, double scale);
+    void set_mips(SDL_Renderer *renderer, std::vector<Image> levels, uint64_t version);
 
    private:
-    // TODO: Write custom deleter with debug logs on delete
-    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_texture{nullptr,
-                                                                          SDL_DestroyTexture};
+    // Past this many regions in a frame, a single bounding box is uploaded instead
+    static constexpr size_t k_max_dirty_rects = 16;
+    // Down to 1/16 of the size, the viewport does not zoom out further than 0.1
+    static constexpr int k_max_mip_levels = 4;
+
+   private:
+    // A single tile unless the image is larger than the renderer allows
+    std::vector<TextureTile> m_tiles;
+    // Levels 1 and up, only on the GPU. Built from the pixels at `m_mips_version`.
+    std::vector<MipLevel> m_mips;
+    uint64_t m_mips_version = 0;
+    bool m_building_mips = false;
+
+    std::shared_ptr<uint32_t> m_pixels;
+
+    int m_width = 0, m_height = 0, m_pitch = 0;
 
-    int m_width, m_height, m_pitch;
+    std::vector<SDL_Rect> m_dirty_rects;
+    uint64_t m_version = 0;
+    uint64_t m_loaded_version = 0;
 
     // NOTE: Do I actually need this ?
     std::string m_path;
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace piksy {
+namespace utils {
+namespace hash {
+
+/// 64-bit xxHash (XXH64) of `size` bytes, fast enough to fingerprint whole files.
+/// Gives the same values as the reference implementation.
+uint64_t xxhash64(const void* data, size_t size, uint64_t seed = 0);
+
+}  // namespace hash
+}  // namespace utils
+}  // namespace piksy
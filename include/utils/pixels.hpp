@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace piksy {
+namespace utils {
+namespace pixels {
+
+/// Pack a color the way SDL_PIXELFORMAT_RGBA8888 stores it (red in the most significant byte)
+inline uint32_t pack_rgba8888(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return (static_cast<uint32_t>(r) << 24) | (static_cast<uint32_t>(g) << 16) |
+           (static_cast<uint32_t>(b) << 8) | static_cast<uint32_t>(a);
+}
+
+/// Squared euclidean distance between two RGBA8888 pixels, all four channels included
+inline int distance_sq_rgba8888(uint32_t lhs, uint32_t rhs) {
+    int distance_sq = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int delta =
+            static_cast<int>((lhs >> shift) & 0xFF) - static_cast<int>((rhs >> shift) & 0xFF);
+        distance_sq += delta * delta;
+    }
+    return distance_sq;
+}
+
+/// Bounding box of the pixels written by a kernel, empty when nothing was written
+struct PixelRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    bool empty() const { return w <= 0 || h <= 0; }
+};
+
+/// Replace every pixel whose distance to `from` is at most `threshold` by `to`.
+/// `pitch` is in bytes. Rows are split across the global thread pool and the widest SIMD
+/// instruction set supported by the CPU (AVX2, SSE2) is picked at runtime.
+/// Returns the number of pixels replaced, their bounding box goes in `out_changed` if set.
+size_t swap_color_rgba8888(uint32_t* pixels, int width, int height, int pitch, uint32_t from,
+                           uint32_t to, uint8_t threshold, PixelRect* out_changed = nullptr);
+
+/// One entry of a palette remap: pixels within `threshold` of `from` become `to`
+struct PaletteEntry {
+    uint32_t from;
+    uint32_t to;
+    uint8_t threshold;
+};
+
+/// Apply a whole palette in a single sweep over the pixels. Each pixel takes the `to` color of
+/// the first entry it matches, entries are not chained (a pixel remapped by one entry is never
+/// matched against the others). Distinct colors are resolved once per chunk through a small
+/// hashed cache, so the cost stays one memory pass whatever the number of entries.
+/// Returns the number of pixels remapped, their bounding box goes in `out_changed` if set.
+size_t remap_palette_rgba8888(uint32_t* pixels, int width, int height, int pitch,
+                              const PaletteEntry* entries, size_t num_entries,
+                              PixelRect* out_changed = nullptr);
+
+/// Fill `out_distances` (width * height values, tightly packed) with the squared distance of
+/// every pixel to `color`, saturated to 65535. Thresholds never exceed 255 so comparing against
+/// `threshold * threshold` gives the exact same answer as the color swap kernel.
+void color_distance_rgba8888(const uint32_t* pixels, int width, int height, int pitch,
+                             uint32_t color, uint16_t* out_distances);
+
+/// Write `highlight` where the distance is within `threshold` and a transparent pixel everywhere
+/// else. `out_pitch` is in bytes. Returns the number of highlighted pixels.
+size_t threshold_overlay_rgba8888(const uint16_t* distances, int width, int height,
+                                  uint8_t threshold, uint32_t highlight, uint32_t* out_pixels,
+                                  int out_pitch);
+
+/// Halve an image with a 2x2 box filter: every channel of an output pixel is the rounded
+/// average of the 4 pixels it covers, an odd last row or column is averaged with itself.
+/// The output is (width + 1) / 2 by (height + 1) / 2 pixels, pitches are in bytes. Rows are
+/// split across the global thread pool, with SSE2 when the CPU has it.
+void downsample_box_2x_rgba8888(const uint32_t* pixels, int width, int height, int pitch,
+                                uint32_t* out_pixels, int out_pitch);
+
+/// Fixed point weights of OpenCV's RGBA2GRAY (14 bit fraction), applied to the first three bytes
+/// of each pixel in memory order
+inline constexpr int k_gray_shift = 14;
+inline constexpr int k_gray_weights[3] = {4899, 9617, 1868};
+
+/// Set bit `x % 64` of `out_bits[x / 64]` for every pixel of the row whose gray level is above
+/// `threshold` and clear it elsewhere, bits past the width included. The gray level is computed
+/// like OpenCV's RGBA2GRAY on the bytes in memory order, rounding included. Runs on the calling
+/// thread only, callers split the rows.
+void gray_mask_bits_rgba8888(const uint32_t* row, int width, int threshold, uint64_t* out_bits);
+
+/// Name of the instruction set used by the pixel kernels on this CPU ("AVX2", "SSE2", "Scalar")
+const char* simd_level_name();
+
+}  // namespace pixels
+}  // namespace utils
+}  // namespace piksy
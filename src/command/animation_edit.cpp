@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <command/animation_edit.hpp>
+#include <core/logger.hpp>
+
+namespace piksy {
+namespace commands {
+
+namespace {
+
+size_t frames_bytes(const std::vector<rendering::Frame>& frames) {
+    return frames.size() * sizeof(rendering::Frame);
+}
+
+size_t snapshot_bytes(const managers::AnimationManager::Snapshot& snapshot) {
+    size_t num_bytes = 0;
+    for (const auto& [name, frames] : snapshot.animations) {
+        num_bytes += name.size() + frames_bytes(frames);
+    }
+    return num_bytes;
+}
+
+}  // namespace
+
+FramesEdit::FramesEdit(const char* name, managers::AnimationManager& animation_manager,
+                       std::string animation_name)
+    : m_name(name),
+      m_animation_manager(animation_manager),
+      m_animation_name(std::move(animation_name)) {}
+
+std::vector<rendering::Frame>* FramesEdit::frames() {
+    rendering::Animation* animation = m_animation_manager.animation(m_animation_name);
+    if (animation == nullptr) {
+        core::Logger::warn("Animation '%s' no longer exists", m_animation_name.c_str());
+        return nullptr;
+    }
+    return &animation->frames;
+}
+
+void FramesEdit::splice(size_t offset, size_t count, std::vector<rendering::Frame> inserted) {
+    std::vector<rendering::Frame>* frames = this->frames();
+    if (frames == nullptr) return;
+
+    offset = std::min(offset, frames->size());
+    count = std::min(count, frames->size() - offset);
+    if (count == 0 && inserted.empty()) return;
+
+    Splice splice;
+    splice.offset = offset;
+    splice.removed.assign(frames->begin() + offset, frames->begin() + offset + count);
+    frames->erase(frames->begin() + offset, frames->begin() + offset + count);
+    frames->insert(frames->begin() + offset, inserted.begin(), inserted.end());
+    splice.inserted = std::move(inserted);
+    m_splices.push_back(std::move(splice));
+}
+
+void FramesEdit::undo() {
+    std::vector<rendering::Frame>* frames = this->frames();
+    if (frames == nullptr) return;
+
+    for (auto splice = m_splices.rbegin(); splice != m_splices.rend(); ++splice) {
+        if (splice->offset + splice->inserted.size() > frames->size()) return;
+
+        auto begin = frames->begin() + splice->offset;
+        frames->erase(begin, begin + splice->inserted.size());
+        frames->insert(frames->begin() + splice->offset, splice->removed.begin(),
+                       splice->removed.end());
+    }
+}
+
+void FramesEdit::redo() {
+    std::vector<rendering::Frame>* frames = this->frames();
+    if (frames == nullptr) return;
+
+    for (const Splice& splice : m_splices) {
+        if (splice.offset + splice.removed.size() > frames->size()) return;
+
+        auto begin = frames->begin() + splice.offset;
+        frames->erase(begin, begin + splice.removed.size());
+        frames->insert(frames->begin() + splice.offset, splice.inserted.begin(),
+                       splice.inserted.end());
+    }
+}
+
+size_t FramesEdit::num_bytes() const {
+    size_t num_bytes = sizeof(*this);
+    for (const Splice& splice : m_splices) {
+        num_bytes += sizeof(Splice) + frames_bytes(splice.removed) + frames_bytes(splice.inserted);
+    }
+    return num_bytes;
+}
+
+AnimationsEdit::AnimationsEdit(const char* name, managers::AnimationManager& animation_manager,
+                               managers::AnimationManager::Snapshot before)
+    : m_name(name),
+      m_animation_manager(animation_manager),
+      m_before(std::move(before)),
+      m_after(animation_manager.snapshot()) {}
+
+size_t AnimationsEdit::num_bytes() const {
+    return sizeof(*this) + snapshot_bytes(m_before) + snapshot_bytes(m_after);
+}
+
+}  // namespace commands
+}  // namespace piksy
@@ -0,0 +1,15 @@
+#include <command/async_command.hpp>
+
+namespace piksy {
+namespace commands {
+
+void AsyncCommand::execute() {
+    if (!prepare()) return;
+
+    CommandContext context;
+    run(context);
+    apply();
+}
+
+}  // namespace commands
+}  // namespace piksy
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <command/animation_edit.hpp>
+#include <command/auto_extract_command.hpp>
+#include <command/frame_extraction_command.hpp>
+#include <core/logger.hpp>
+#include <extraction/frame_hash.hpp>
+
+namespace piksy {
+namespace commands {
+
+AutoExtractCommand::AutoExtractCommand(std::shared_ptr<rendering::Texture2D> texture,
+                                       managers::AnimationManager& animation_manager,
+                                       std::string animation_name, bool append,
+                                       const extraction::ExtractionSettings& settings,
+                                       History* history)
+    : m_texture(texture),
+      m_animation_manager(animation_manager),
+      m_animation_name(std::move(animation_name)),
+      m_append(append),
+      m_settings(settings),
+      m_history(history) {}
+
+bool AutoExtractCommand::prepare() {
+    if (m_texture == nullptr) return false;
+
+    m_snapshot = m_texture->snapshot();
+    if (m_snapshot.empty()) {
+        core::Logger::warn("Auto extraction needs the CPU pixels of the texture");
+        return false;
+    }
+    return true;
+}
+
+void AutoExtractCommand::run(CommandContext& context) {
+    auto start = std::chrono::steady_clock::now();
+
+    m_frames.clear();
+    for (const auto& component : extraction::label_components(m_snapshot.pixels, m_settings)) {
+        m_frames.emplace_back(component.x, component.y, component.w, component.h);
+    }
+    if (context.is_cancelled()) return;
+
+    FrameExtractionCommand::sort_frames(m_frames);
+    context.set_progress(1.0f);
+
+    auto elapsed =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    core::Logger::info("Extracted %zu frames from %dx%d in %.1f ms", m_frames.size(),
+                       m_snapshot.pixels.width, m_snapshot.pixels.height, elapsed.count());
+}
+
+void AutoExtractCommand::apply() {
+    m_snapshot = {};
+
+    rendering::Animation* animation = m_animation_manager.animation(m_animation_name);
+    if (animation == nullptr) {
+        core::Logger::warn("Animation '%s' no longer exists, the extracted frames are dropped",
+                           m_animation_name.c_str());
+        return;
+    }
+
+    auto edit = std::make_unique<FramesEdit>("Auto extraction", m_animation_manager,
+                                             m_animation_name);
+    if (!m_append) {
+        edit->splice(0, animation->frames.size(), std::move(m_frames));
+    } else {
+        // Against the frames of the animation now, they may have changed while labelling
+        extraction::FrameHash existing_frames;
+        existing_frames.insert(animation->frames);
+
+        std::vector<rendering::Frame> new_frames;
+        for (const auto& frame : m_frames) {
+            if (!existing_frames.contains_similar(frame)) new_frames.push_back(frame);
+        }
+        edit->splice(animation->frames.size(), 0, std::move(new_frames));
+    }
+
+    if (m_history != nullptr && !edit->empty()) m_history->push(std::move(edit));
+}
+
+}  // namespace commands
+}  // namespace piksy
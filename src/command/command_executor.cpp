@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <command/command_executor.hpp>
+#include <core/logger.hpp>
+#include <exception>
+
+namespace piksy {
+namespace commands {
+
+CommandExecutor::CommandExecutor(size_t max_running, core::ThreadPool& pool)
+    : m_max_running(std::max<size_t>(max_running, 1)), m_pool(pool) {}
+
+CommandExecutor::~CommandExecutor() { shutdown(); }
+
+uint64_t CommandExecutor::submit(std::unique_ptr<Command> command, CommandPriority priority,
+                                 std::function<void()> on_done) {
+    if (command == nullptr) return 0;
+
+    auto job = std::make_unique<Job>();
+    job->id = m_next_id++;
+    job->priority = priority;
+    job->async_command = dynamic_cast<AsyncCommand*>(command.get());
+    job->command = std::move(command);
+    job->context = std::make_shared<CommandContext>(job->token);
+    job->on_done = std::move(on_done);
+
+    m_jobs.push_back(std::move(job));
+    return m_jobs.back()->id;
+}
+
+void CommandExecutor::cancel(uint64_t id) {
+    auto it = std::find_if(m_jobs.begin(), m_jobs.end(),
+                           [id](const std::unique_ptr<Job>& job) { return job->id == id; });
+    if (it == m_jobs.end()) return;
+
+    (*it)->token.cancel();
+    // A running command is only forgotten once its worker let go of it
+    if (!(*it)->is_running) m_jobs.erase(it);
+}
+
+void CommandExecutor::cancel_all() {
+    for (auto& job : m_jobs) job->token.cancel();
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+                                [](const std::unique_ptr<Job>& job) { return !job->is_running; }),
+                 m_jobs.end());
+}
+
+void CommandExecutor::update() {
+    // Taken out of the queue first: applying a command may submit new ones
+    std::vector<std::unique_ptr<Job>> finished;
+    for (auto& job : m_jobs) {
+        if (job->is_running && job->result.is_ready()) finished.push_back(std::move(job));
+    }
+    m_jobs.erase(std::remove(m_jobs.begin(), m_jobs.end(), nullptr), m_jobs.end());
+    for (auto& job : finished) {
+        if (finish(*job)) continue;
+
+        // Started again on what changed meanwhile, it keeps its place in the queue
+        auto position = std::find_if(m_jobs.begin(), m_jobs.end(),
+                                     [&](const std::unique_ptr<Job>& other) {
+                                         return other->id > job->id;
+                                     });
+        m_jobs.insert(position, std::move(job));
+    }
+
+    while (num_running() < m_max_running) {
+        auto next = std::end(m_jobs);
+        for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+            if ((*it)->is_running || is_target_busy(**it)) continue;
+            if (next == m_jobs.end() || (*it)->priority > (*next)->priority) next = it;
+        }
+        if (next == m_jobs.end()) break;
+
+        Job& job = **next;
+        if (job.async_command != nullptr && prepare(job)) {
+            start(job);
+            continue;
+        }
+
+        std::unique_ptr<Job> done = std::move(*next);
+        m_jobs.erase(next);
+        if (done->async_command == nullptr) {
+            done->command->execute();
+            if (done->on_done) done->on_done();
+        }
+    }
+}
+
+void CommandExecutor::shutdown() {
+    cancel_all();
+    for (auto& job : m_jobs) {
+        try {
+            job->result.get();
+        } catch (...) {
+            // Cancelled, nobody is left to report it to
+        }
+    }
+    m_jobs.clear();
+}
+
+std::vector<CommandStatus> CommandExecutor::status() const {
+    std::vector<const Job*> jobs;
+    for (const auto& job : m_jobs) jobs.push_back(job.get());
+    std::stable_sort(jobs.begin(), jobs.end(), [](const Job* lhs, const Job* rhs) {
+        if (lhs->is_running != rhs->is_running) return lhs->is_running;
+        return lhs->priority > rhs->priority;
+    });
+
+    std::vector<CommandStatus> statuses;
+    statuses.reserve(jobs.size());
+    for (const Job* job : jobs) {
+        const char* name = job->async_command ? job->async_command->name() : "Command";
+        statuses.push_back({job->id, name, job->context->progress(), job->is_running});
+    }
+    return statuses;
+}
+
+bool CommandExecutor::prepare(Job& job) {
+    try {
+        return job.async_command->prepare();
+    } catch (const std::exception& ex) {
+        core::Logger::error("%s failed: %s", job.async_command->name(), ex.what());
+        return false;
+    }
+}
+
+void CommandExecutor::start(Job& job) {
+    job.is_running = true;
+    job.result = core::async(
+        [command = job.command, async_command = job.async_command, context = job.context] {
+            if (!context->is_cancelled()) async_command->run(*context);
+        },
+        m_pool);
+}
+
+bool CommandExecutor::finish(Job& job) {
+    job.is_running = false;
+    try {
+        job.result.get();
+    } catch (const std::exception& ex) {
+        core::Logger::error("%s failed: %s", job.async_command->name(), ex.what());
+        return true;
+    }
+
+    if (job.token.is_cancelled()) {
+        core::Logger::info("%s cancelled", job.async_command->name());
+        return true;
+    }
+
+    if (job.async_command->is_stale()) {
+        core::Logger::debug("The input of %s changed while it was running, running it again",
+                            job.async_command->name());
+        if (!prepare(job)) return true;
+
+        job.context->set_progress(0.0f);
+        start(job);
+        return false;
+    }
+
+    job.async_command->apply();
+    if (job.on_done) job.on_done();
+    return true;
+}
+
+bool CommandExecutor::is_target_busy(const Job& job) const {
+    const void* target = job.async_command ? job.async_command->target() : nullptr;
+    if (target == nullptr) return false;
+
+    return std::any_of(m_jobs.begin(), m_jobs.end(), [target](const std::unique_ptr<Job>& other) {
+        return other->is_running && other->async_command->target() == target;
+    });
+}
+
+size_t CommandExecutor::num_running() const {
+    return std::count_if(m_jobs.begin(), m_jobs.end(),
+                         [](const std::unique_ptr<Job>& job) { return job->is_running; });
+}
+
+}  // namespace commands
+}  // namespace piksy
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <command/history.hpp>
+#include <command/pixel_edit.hpp>
+#include <core/logger.hpp>
+
+namespace piksy {
+namespace commands {
+
+History::History(size_t max_bytes, size_t max_edits)
+    : m_max_bytes(max_bytes), m_max_edits(std::max<size_t>(max_edits, 1)) {}
+
+History::~History() = default;
+
+void History::push(std::unique_ptr<Edit> edit) {
+    if (edit == nullptr) return;
+
+    for (const auto& dropped : m_redo) m_num_bytes -= dropped->num_bytes();
+    m_redo.clear();
+
+    m_num_bytes += edit->num_bytes();
+    m_undo.push_back(std::move(edit));
+    trim();
+}
+
+void History::undo() {
+    if (!can_undo()) return;
+
+    std::unique_ptr<Edit> edit = std::move(m_undo.back());
+    m_undo.pop_back();
+    edit->undo();
+    core::Logger::info("Undo %s", edit->name());
+    m_redo.push_back(std::move(edit));
+}
+
+void History::redo() {
+    if (!can_redo()) return;
+
+    std::unique_ptr<Edit> edit = std::move(m_redo.back());
+    m_redo.pop_back();
+    edit->redo();
+    core::Logger::info("Redo %s", edit->name());
+    m_undo.push_back(std::move(edit));
+}
+
+void History::clear() {
+    m_undo.clear();
+    m_redo.clear();
+    m_tile_stores.clear();
+    m_num_bytes = 0;
+}
+
+void History::forget(const rendering::Texture2D* texture) {
+    if (texture == nullptr) return;
+
+    auto is_forgotten = [this, texture](const std::unique_ptr<Edit>& edit) {
+        if (edit->texture() != texture) return false;
+        m_num_bytes -= edit->num_bytes();
+        return true;
+    };
+    m_undo.erase(std::remove_if(m_undo.begin(), m_undo.end(), is_forgotten), m_undo.end());
+    m_redo.erase(std::remove_if(m_redo.begin(), m_redo.end(), is_forgotten), m_redo.end());
+    m_tile_stores.erase(texture);
+}
+
+std::shared_ptr<TileStore> History::tile_store(const rendering::Texture2D* texture) {
+    std::shared_ptr<TileStore>& store = m_tile_stores[texture];
+    if (store == nullptr) store = std::make_shared<TileStore>();
+    return store;
+}
+
+void History::trim() {
+    // The newest edit always stays, even alone over the budget
+    while (m_undo.size() > 1 && (m_num_bytes > m_max_bytes || m_undo.size() > m_max_edits)) {
+        m_num_bytes -= m_undo.front()->num_bytes();
+        m_undo.pop_front();
+    }
+
+    // Stores no edit refers to anymore, their texture may even be gone
+    for (auto it = m_tile_stores.begin(); it != m_tile_stores.end();) {
+        it = it->second.use_count() == 1 ? m_tile_stores.erase(it) : std::next(it);
+    }
+}
+
+}  // namespace commands
+}  // namespace piksy
@@ -1,7 +1,9 @@
+#include <command/animation_edit.hpp>
 #include <command/load_command.hpp>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <stdexcept>
 #include <utilities/json.hpp>
 
@@ -14,11 +16,12 @@ namespace commands {
 
 LoadCommand::LoadCommand(const fs::path& load_path, core::State& m_state,
                          managers::ResourceManager& resource_manager,
-                         managers::AnimationManager& animation_manager)
+                         managers::AnimationManager& animation_manager, History* history)
     : m_load_path(load_path),
       m_state(m_state),
       m_resource_manager(resource_manager),
-      m_animation_manager(animation_manager) {}
+      m_animation_manager(animation_manager),
+      m_history(history) {}
 
 void LoadCommand::execute() {
     try {
@@ -66,6 +69,8 @@ void LoadCommand::load(std::istream& load_file_stream) {
         }
 
         // Load animations
+        managers::AnimationManager::Snapshot previous_animations;
+        if (m_history != nullptr) previous_animations = m_animation_manager.snapshot();
         if (j.contains("animations")) {
             m_animation_manager.clear();
             for (const auto& anim_json : j["animations"]) {
@@ -97,6 +102,11 @@ void LoadCommand::load(std::istream& load_file_stream) {
             m_animation_manager.set_current_animation(j["current_animation"]);
         }
 
+        if (m_history != nullptr) {
+            m_history->push(std::make_unique<AnimationsEdit>("Open", m_animation_manager,
+                                                             std::move(previous_animations)));
+        }
+
         // Load texture sprite
         if (j.contains("sprite") && j["sprite"].size() > 0) {
             const auto& texture_json = j["sprite"][0]["texture"];
@@ -0,0 +1,40 @@
+#include <command/palette_remap_command.hpp>
+#include <core/logger.hpp>
+#include <utils/pixels.hpp>
+
+namespace piksy {
+namespace commands {
+
+PaletteRemapCommand::PaletteRemapCommand(std::vector<PaletteSwap> palette,
+                                         std::shared_ptr<rendering::Texture2D> texture,
+                                         History* history)
+    : PixelCommand(texture, history), m_palette(std::move(palette)) {}
+
+bool PaletteRemapCommand::prepare() {
+    if (m_palette.empty()) return false;
+
+    m_entries.clear();
+    m_entries.reserve(m_palette.size());
+    for (const auto& swap : m_palette) {
+        m_entries.push_back(
+            {utils::pixels::pack_rgba8888(swap.from.r, swap.from.g, swap.from.b, swap.from.a),
+             utils::pixels::pack_rgba8888(swap.to.r, swap.to.g, swap.to.b, swap.to.a),
+             swap.threshold});
+    }
+
+    return PixelCommand::prepare();
+}
+
+size_t PaletteRemapCommand::edit(uint32_t* pixels, int width, int height, int pitch,
+                                 utils::pixels::PixelRect& out_changed) const {
+    return utils::pixels::remap_palette_rgba8888(pixels, width, height, pitch, m_entries.data(),
+                                                 m_entries.size(), &out_changed);
+}
+
+void PaletteRemapCommand::on_applied(size_t num_remapped) {
+    core::Logger::debug("Number of pixels remapped: %zu", num_remapped);
+    core::Logger::info("Remapped %zu colors of the texture", m_palette.size());
+}
+
+}  // namespace commands
+}  // namespace piksy
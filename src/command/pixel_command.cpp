@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <command/pixel_command.hpp>
+#include <core/logger.hpp>
+#include <cstring>
+#include <vector>
+
+namespace piksy {
+namespace commands {
+
+PixelCommand::PixelCommand(std::shared_ptr<rendering::Texture2D> texture, History* history)
+    : m_texture(std::move(texture)), m_history(history) {}
+
+bool PixelCommand::prepare() {
+    if (m_texture == nullptr) return false;
+
+    m_snapshot = m_texture->snapshot();
+    return !m_snapshot.empty();
+}
+
+void PixelCommand::run(CommandContext& context) {
+    const rendering::PixelView& pixels = m_snapshot.pixels;
+    m_has_result = false;
+
+    // Only one band is copied at a time, the texture is never duplicated as a whole
+    const int band_pitch = pixels.width * static_cast<int>(sizeof(uint32_t));
+    std::vector<uint32_t> band(static_cast<size_t>(pixels.width) *
+                               std::min(k_rows_per_band, pixels.height));
+
+    SDL_Rect changed{0, 0, 0, 0};
+    size_t num_changed = 0;
+    std::vector<PixelEdit::TileChange> tiles;
+    for (int y = 0; y < pixels.height; y += k_rows_per_band) {
+        if (context.is_cancelled()) return;
+
+        const int rows = std::min(k_rows_per_band, pixels.height - y);
+        for (int row = 0; row < rows; ++row) {
+            std::memcpy(band.data() + static_cast<size_t>(row) * pixels.width,
+                        pixels.row(y + row), pixels.width * sizeof(uint32_t));
+        }
+        utils::pixels::PixelRect band_changed;
+        num_changed += edit(band.data(), pixels.width, rows, band_pitch, band_changed);
+        if (!band_changed.empty()) {
+            SDL_Rect band_rect{band_changed.x, y + band_changed.y, band_changed.w, band_changed.h};
+            if (SDL_RectEmpty(&changed)) {
+                changed = band_rect;
+            } else {
+                SDL_UnionRect(&changed, &band_rect, &changed);
+            }
+
+            rendering::PixelView before{pixels.row(y), pixels.width, rows, pixels.pitch};
+            rendering::PixelView after{band.data(), pixels.width, rows, band_pitch};
+            SDL_Rect local{band_changed.x, band_changed.y, band_changed.w, band_changed.h};
+            for (PixelEdit::TileChange& tile :
+                 PixelEdit::diff(before, after, local, y, m_history != nullptr)) {
+                tiles.push_back(std::move(tile));
+            }
+        }
+        context.set_progress(static_cast<float>(y + rows) / pixels.height);
+    }
+
+    m_tiles = std::move(tiles);
+    m_changed = changed;
+    m_num_changed = num_changed;
+    m_has_result = true;
+}
+
+bool PixelCommand::is_stale() const {
+    return m_has_result && m_texture->version() != m_snapshot.version;
+}
+
+void PixelCommand::apply() {
+    if (!m_has_result) return;
+    m_has_result = false;
+
+    const uint64_t base_version = m_snapshot.version;
+    // The texture owns the pixels alone again, they are edited in place below
+    m_snapshot = {};
+    // The executor runs a stale command again instead of applying it, this only fails when
+    // executed directly while something else edits the texture
+    if (m_texture->version() != base_version) {
+        core::Logger::warn("The texture changed while %s was running, it was not applied",
+                           name());
+        m_tiles.clear();
+        return;
+    }
+
+    const int pitch = m_texture->pixels().pitch;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(m_texture->mutable_pixels());
+    if (bytes == nullptr) return;
+    for (const PixelEdit::TileChange& change : m_tiles) {
+        const SDL_Rect& rect = change.after->rect;
+        for (int y = 0; y < rect.h; ++y) {
+            uint32_t* row =
+                reinterpret_cast<uint32_t*>(bytes + static_cast<size_t>(rect.y + y) * pitch);
+            std::memcpy(row + rect.x, change.after->pixels.data() + static_cast<size_t>(y) * rect.w,
+                        rect.w * sizeof(uint32_t));
+        }
+    }
+    if (!m_tiles.empty()) m_texture->mark_dirty(m_changed);
+
+    if (m_history != nullptr && !m_tiles.empty()) {
+        m_history->push(std::make_unique<PixelEdit>(name(), m_texture,
+                                                    m_history->tile_store(m_texture.get()),
+                                                    std::move(m_tiles), base_version));
+    }
+    m_tiles.clear();
+    on_applied(m_num_changed);
+}
+
+}  // namespace commands
+}  // namespace piksy
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <command/pixel_edit.hpp>
+#include <core/logger.hpp>
+#include <cstring>
+
+namespace piksy {
+namespace commands {
+
+namespace {
+
+// `rect` is in the coordinates of `pixels`, the tile is `first_row` rows lower in the texture
+TileRef copy_tile(const rendering::PixelView& pixels, const SDL_Rect& rect, int first_row) {
+    auto tile = std::make_shared<Tile>();
+    tile->rect = {rect.x, first_row + rect.y, rect.w, rect.h};
+    tile->pixels.resize(static_cast<size_t>(rect.w) * rect.h);
+    for (int y = 0; y < rect.h; ++y) {
+        std::memcpy(tile->pixels.data() + static_cast<size_t>(y) * rect.w,
+                    pixels.row(rect.y + y) + rect.x, rect.w * sizeof(uint32_t));
+    }
+    return tile;
+}
+
+}  // namespace
+
+TileRef TileStore::find(uint64_t version, size_t index) const {
+    if (version != m_version) return nullptr;
+
+    auto it = m_tiles.find(index);
+    return it != m_tiles.end() ? it->second : nullptr;
+}
+
+void TileStore::update(uint64_t base_version, uint64_t version,
+                       const std::vector<std::pair<size_t, TileRef>>& tiles) {
+    // Changed behind the back of the history (reload, unrecorded edit...), start over
+    if (base_version != m_version) m_tiles.clear();
+
+    m_version = version;
+    for (const auto& [index, tile] : tiles) m_tiles[index] = tile;
+}
+
+std::vector<PixelEdit::TileChange> PixelEdit::diff(const rendering::PixelView& before,
+                                                   const rendering::PixelView& after,
+                                                   const SDL_Rect& changed, int first_row,
+                                                   bool with_before) {
+    std::vector<TileChange> tiles;
+    if (before.empty() || before.width != after.width || before.height != after.height) {
+        return tiles;
+    }
+
+    SDL_Rect bounds{0, 0, before.width, before.height}, area;
+    if (!SDL_IntersectRect(&changed, &bounds, &area)) return tiles;
+
+    const int columns = (before.width + k_tile_size - 1) / k_tile_size;
+    const int first_tile_row = first_row / k_tile_size;
+    for (int ty = area.y / k_tile_size; ty * k_tile_size < area.y + area.h; ++ty) {
+        for (int tx = area.x / k_tile_size; tx * k_tile_size < area.x + area.w; ++tx) {
+            SDL_Rect rect{tx * k_tile_size, ty * k_tile_size, 0, 0};
+            rect.w = std::min(k_tile_size, before.width - rect.x);
+            rect.h = std::min(k_tile_size, before.height - rect.y);
+
+            bool differs = false;
+            for (int y = rect.y; y < rect.y + rect.h && !differs; ++y) {
+                differs = std::memcmp(before.row(y) + rect.x, after.row(y) + rect.x,
+                                      rect.w * sizeof(uint32_t)) != 0;
+            }
+            if (!differs) continue;
+
+            tiles.push_back({static_cast<size_t>(first_tile_row + ty) * columns + tx,
+                             with_before ? copy_tile(before, rect, first_row) : nullptr,
+                             copy_tile(after, rect, first_row)});
+        }
+    }
+    return tiles;
+}
+
+PixelEdit::PixelEdit(const char* name, std::shared_ptr<rendering::Texture2D> texture,
+                     std::shared_ptr<TileStore> store, std::vector<TileChange> tiles,
+                     uint64_t base_version)
+    : m_name(name), m_texture(std::move(texture)), m_store(std::move(store)),
+      m_tiles(std::move(tiles)), m_base_version(base_version),
+      m_version(m_texture->version()) {
+    std::vector<std::pair<size_t, TileRef>> afters;
+    afters.reserve(m_tiles.size());
+    for (TileChange& tile : m_tiles) {
+        // Same pixels as the copy made by diff(), the one already held by the previous edit
+        // is kept instead
+        if (TileRef known = m_store->find(base_version, tile.index)) tile.before = known;
+        afters.emplace_back(tile.index, tile.after);
+    }
+    m_store->update(base_version, m_version, afters);
+}
+
+void PixelEdit::undo() { write(false); }
+
+void PixelEdit::redo() { write(true); }
+
+size_t PixelEdit::num_bytes() const {
+    // A tile shared with another edit is counted by both, the budget errs on the safe side
+    size_t num_bytes = sizeof(*this);
+    for (const TileChange& tile : m_tiles) {
+        num_bytes += 2 * sizeof(Tile) + (tile.before->pixels.size() + tile.after->pixels.size()) *
+                                            sizeof(uint32_t);
+    }
+    return num_bytes;
+}
+
+void PixelEdit::write(bool after) {
+    rendering::PixelView pixels = m_texture->pixels();
+    const uint64_t base_version = m_texture->version();
+    uint32_t* destination = m_texture->mutable_pixels();
+    if (destination == nullptr) return;
+
+    // Written over the pixels this edit expects, the result is a version known before. Keeping
+    // it means a texture undone back to its loaded pixels is not modified anymore.
+    const bool restores = base_version == (after ? m_base_version : m_version);
+    std::vector<std::pair<size_t, TileRef>> written;
+    written.reserve(m_tiles.size());
+    for (const TileChange& change : m_tiles) {
+        const TileRef& tile = after ? change.after : change.before;
+        const SDL_Rect& rect = tile->rect;
+        if (rect.x + rect.w > pixels.width || rect.y + rect.h > pixels.height) {
+            core::Logger::warn("The texture was resized, cannot restore the tile at (%d, %d)",
+                               rect.x, rect.y);
+            continue;
+        }
+
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(destination);
+        for (int y = 0; y < rect.h; ++y) {
+            uint32_t* row =
+                reinterpret_cast<uint32_t*>(bytes + static_cast<size_t>(rect.y + y) * pixels.pitch);
+            std::memcpy(row + rect.x, tile->pixels.data() + static_cast<size_t>(y) * rect.w,
+                        rect.w * sizeof(uint32_t));
+        }
+        m_texture->mark_dirty(rect);
+        written.emplace_back(change.index, tile);
+    }
+    if (restores && written.size() == m_tiles.size()) {
+        m_texture->restore_version(after ? m_version : m_base_version);
+    }
+    m_store->update(base_version, m_texture->version(), written);
+}
+
+}  // namespace commands
+}  // namespace piksy
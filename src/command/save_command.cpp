@@ -14,40 +14,9 @@ SaveCommand::SaveCommand(fs::path save_path, core::State& state,
                          managers::AnimationManager& animation_manager)
     : m_save_path(std::move(save_path)), m_state(state), m_animation_manager(animation_manager) {}
 
-void SaveCommand::execute() {
-    try {
-        core::Logger::info("Saving the application state...");
-
-        if (!fs::exists(m_save_path)) {
-            core::Logger::warn("Save file does not exists yet, creating it... (path: %s)",
-                               m_save_path.c_str());
-            try {
-                if (std::filesystem::create_directories(m_save_path.parent_path())) {
-                    core::Logger::info("Save directories created at: %s",
-                                       m_save_path.parent_path().c_str());
-                } else {
-                    core::Logger::debug("Save directories already exist: %s", m_save_path.c_str());
-                }
-            } catch (const std::filesystem::filesystem_error& e) {
-                core::Logger::error("Error creating directories: %s", e.what());
-            }
-        }
-
-        std::ofstream save_file(m_save_path);
-        if (!save_file.is_open()) {
-            core::Logger::error("Failed to save: failed to open the save file.");
-            return;
-        }
-
-        save(save_file);
-
-        save_file.close();
-    } catch (const std::exception& ex) {
-        core::Logger::error("Failed to save: %s", ex.what());
-    }
-}
+bool SaveCommand::prepare() {
+    core::Logger::info("Saving the application state...");
 
-void SaveCommand::save(std::ostream& save_file_stream) {
     auto now = std::chrono::system_clock::now();
     std::time_t now_c = std::chrono::system_clock::to_time_t(now);
     char timestamp_buf[100];
@@ -92,6 +61,37 @@ void SaveCommand::save(std::ostream& save_file_stream) {
         },
     };
 
+    m_json = std::move(j);
+    return true;
+}
+
+void SaveCommand::run(CommandContext& context) {
+    if (context.is_cancelled()) return;
+
+    try {
+        if (!fs::exists(m_save_path)) {
+            core::Logger::warn("Save file does not exists yet, creating it... (path: %s)",
+                               m_save_path.c_str());
+            try {
+                if (std::filesystem::create_directories(m_save_path.parent_path())) {
+                    core::Logger::info("Save directories created at: %s",
+                                       m_save_path.parent_path().c_str());
+                } else {
+                    core::Logger::debug("Save directories already exist: %s", m_save_path.c_str());
+                }
+            } catch (const std::filesystem::filesystem_error& e) {
+                core::Logger::error("Error creating directories: %s", e.what());
+            }
+        }
+
+        save(m_json);
+        context.set_progress(1.0f);
+    } catch (const std::exception& ex) {
+        core::Logger::error("Failed to save: %s", ex.what());
+    }
+}
+
+void SaveCommand::save(const nlohmann::json& j) {
     // Write to a temporary file first for atomic saving
     auto temp_path = m_save_path;
     temp_path.replace_extension(".tmp");
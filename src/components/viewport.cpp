@@ -6,13 +6,19 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <cmath>
+#include <command/animation_edit.hpp>
+#include <command/auto_extract_command.hpp>
 #include <command/frame_extraction_command.hpp>
+#include <command/palette_remap_command.hpp>
 #include <command/swap_texture_color_command.hpp>
 #include <components/viewport.hpp>
 #include <core/logger.hpp>
 #include <core/state.hpp>
-#include <opencv2/opencv.hpp>
+#include <functional>
+#include <memory>
 #include <rendering/sprite.hpp>
+#include <string>
 #include <utils/maths.hpp>
 #include <vector>
 
@@ -26,11 +32,14 @@ namespace components {
 
 Viewport::Viewport(core::State& state, rendering::Renderer& renderer,
                    managers::ResourceManager& resource_manager,
-                   managers::AnimationManager& animation_manager)
+                   managers::AnimationManager& animation_manager,
+                   commands::CommandExecutor& command_executor, commands::History& history)
     : UIComponent(state),
       m_renderer(renderer),
       m_resource_manager(resource_manager),
       m_animation_manager(animation_manager),
+      m_command_executor(command_executor),
+      m_history(history),
       m_render_texture(nullptr),
       m_viewport_size(800, 600) {
     create_render_texture(static_cast<int>(m_viewport_size.x), static_cast<int>(m_viewport_size.y));
@@ -60,32 +69,46 @@ void Viewport::create_render_texture(int width, int height) {
 void Viewport::update() {
     update_zoom();
     update_pan();
+    m_state.texture_sprite.update();
+
+    // Pick up the latest preview computed in the background, the worker never writes to it
+    m_preview = m_preview_extractor.result();
+
+    if (m_color_swap_preview.is_active()) {
+        if (m_state.current_tool != tools::Tool::COLOR_SWAP ||
+            m_state.texture_sprite.texture() != m_color_swap_preview.texture() ||
+            ImGui::IsKeyDown(ImGuiKey_Escape)) {
+            m_color_swap_preview.clear();
+        } else if (ImGui::IsKeyPressed(ImGuiKey_Enter)) {
+            commit_color_swap();
+        }
+    }
 
     auto animation = m_animation_manager.current_animation();
     if (animation == nullptr) {
         return;
     }
 
-    // Handle frame extraction commit when mouse is released
+    // Handle frame extraction commit when mouse is released, once the preview of the final
+    // selection has arrived
     if (m_state.current_tool == tools::Tool::EXTRACT && !m_state.mouse_state.is_pressed &&
-        m_is_previewing) {
-        // Mouse was released and we were previewing - commit the frames
-
+        m_is_previewing && m_preview_extractor.is_up_to_date()) {
         // Check if we should append (shift key) or replace frames
         bool should_append = ImGui::IsKeyDown(ImGuiKey_LeftShift);
 
         // Commit the preview frames
-        if (!m_preview_frames.empty()) {
-            if (!should_append) {
-                animation->frames.clear();
-            }
-            animation->frames.insert(animation->frames.end(), m_preview_frames.begin(),
-                                     m_preview_frames.end());
-
-            core::Logger::debug("Committed %zu frames to animation", m_preview_frames.size());
+        if (m_preview != nullptr && !m_preview->frames.empty()) {
+            commands::FramesEdit edit("Extract frames", m_animation_manager,
+                                      m_animation_manager.current_animation_name());
+            size_t offset = should_append ? animation->frames.size() : 0;
+            edit.splice(offset, animation->frames.size() - offset, m_preview->frames);
+            record(std::move(edit));
+
+            core::Logger::debug("Committed %zu frames to animation", m_preview->frames.size());
         }
 
-        m_preview_frames.clear();
+        m_preview_extractor.cancel();
+        m_preview.reset();
         m_is_previewing = false;
     }
 
@@ -97,11 +120,16 @@ void Viewport::update() {
     // Rest of the update code...
     if (ImGui::IsKeyDown(ImGuiKey_Backspace)) {
         if (!m_state.animation_state.selected_frames.empty()) {
-            for (size_t i : m_state.animation_state.selected_frames) {
-                if (i < animation->frames.size()) {
-                    animation->frames.erase(animation->frames.begin() + i);
-                }
-            }
+            // Highest index first, so erasing a frame does not move the next ones
+            std::vector<size_t> selected(m_state.animation_state.selected_frames.begin(),
+                                         m_state.animation_state.selected_frames.end());
+            std::sort(selected.rbegin(), selected.rend());
+
+            commands::FramesEdit edit("Delete frames", m_animation_manager,
+                                      m_animation_manager.current_animation_name());
+            for (size_t i : selected) edit.splice(i, 1, {});
+            record(std::move(edit));
+
             m_state.animation_state.selected_frames.clear();
         }
     }
@@ -116,8 +144,13 @@ void Viewport::update() {
                 if (animation == nullptr) {
                     break;
                 }
-                animation->frames.clear();
-                m_preview_frames.clear();
+                commands::FramesEdit edit("Clear frames", m_animation_manager,
+                                          m_animation_manager.current_animation_name());
+                edit.splice(0, animation->frames.size(), {});
+                record(std::move(edit));
+
+                m_preview_extractor.cancel();
+                m_preview.reset();
                 m_is_previewing = false;
                 m_state.animation_state.current_frame = 0;
                 m_state.animation_state.selected_frames.clear();
@@ -153,12 +186,25 @@ void Viewport::render() {
     render_grid_background();
     render_texture();
 
+    if (m_color_swap_preview.is_active()) {
+        m_color_swap_preview.update(
+            m_renderer.get(),
+            static_cast<uint8_t>(std::clamp(m_state.color_swap_state.threshold, 0, 255)));
+        m_state.texture_sprite.render_overlay(
+            m_renderer.get(), m_color_swap_preview.overlay(), m_state.zoom_state.current_scale,
+            m_state.pan_state.current_offset.x, m_state.pan_state.current_offset.y);
+    }
+
     if (m_state.mouse_state.is_pressed && !m_state.mouse_state.is_panning) {
         render_selection_rect();
     }
 
     render_frames();
 
+    if (m_state.current_tool == tools::Tool::AUTO_EXTRACT) {
+        render_component_preview();
+    }
+
     SDL_SetRenderTarget(m_renderer.get(), nullptr);
 
     ImGui::Image((ImTextureID)(intptr_t)m_render_texture, m_viewport_size);
@@ -167,6 +213,15 @@ void Viewport::render() {
 
     render_cursor_hud();
 
+    if (m_state.current_tool == tools::Tool::COLOR_SWAP) {
+        render_color_swap_panel();
+    }
+
+    if (m_state.current_tool == tools::Tool::EXTRACT ||
+        m_state.current_tool == tools::Tool::AUTO_EXTRACT) {
+        render_extraction_panel();
+    }
+
     /* ImGuiAxis toolbar_axis = ImGuiAxis_Y; */
     /* DockingToolbar("Toolbar", &toolbar_axis); */
 
@@ -243,13 +298,22 @@ void Viewport::process_panning() {
 }
 
 void Viewport::update_zoom() {
-    m_state.zoom_state.current_scale =
-        utils::maths::lerp(m_state.zoom_state.current_scale, m_state.zoom_state.target_scale, 0.1f);
+    core::ZoomState& zoom = m_state.zoom_state;
+    zoom.current_scale = utils::maths::lerp(zoom.current_scale, zoom.target_scale, 0.1f);
+    // The lerp only ever gets closer, snap once the difference no longer shows so the
+    // application can go idle
+    if (std::abs(zoom.current_scale - zoom.target_scale) < k_zoom_epsilon * zoom.target_scale) {
+        zoom.current_scale = zoom.target_scale;
+    }
 }
 
 void Viewport::update_pan() {
-    m_state.pan_state.current_offset =
-        utils::maths::lerp(m_state.pan_state.current_offset, m_state.pan_state.target_offset, 0.1f);
+    core::PanState& pan = m_state.pan_state;
+    pan.current_offset = utils::maths::lerp(pan.current_offset, pan.target_offset, 0.1f);
+    if (std::abs(pan.current_offset.x - pan.target_offset.x) < k_pan_epsilon &&
+        std::abs(pan.current_offset.y - pan.target_offset.y) < k_pan_epsilon) {
+        pan.current_offset = pan.target_offset;
+    }
 }
 
 void Viewport::process_selection() {
@@ -270,14 +334,11 @@ void Viewport::process_selection() {
         case tools::Tool::EXTRACT: {
             if (!m_state.texture_sprite.texture()) return;
 
-            // Update preview while dragging
+            // Update preview while dragging, computed in the background so a slow labelling does
+            // not hold the frame. The texture is only labelled again after an edit.
             m_is_previewing = true;
-            commands::FrameExtractionCommand preview_command(
-                selection_world_rect, m_state.texture_sprite.texture(), m_preview_frames,
-                false,  // don't append in preview
-                true    // preview mode
-            );
-            preview_command.execute();
+            m_preview_extractor.request(m_state.texture_sprite.texture()->snapshot(),
+                                        selection_world_rect, m_state.extraction_settings);
         } break;
 
         case tools::Tool::SELECT: {
@@ -303,12 +364,15 @@ void Viewport::process_selection() {
 }
 
 void Viewport::render_texture() {
-    if (m_state.texture_sprite.texture() != nullptr) {
+    auto texture = m_state.texture_sprite.texture();
+    if (texture != nullptr && texture->is_loaded()) {
         m_state.texture_sprite.render(m_renderer.get(), m_state.zoom_state.current_scale,
                                       m_state.pan_state.current_offset.x,
                                       m_state.pan_state.current_offset.y);
+    } else if (texture != nullptr && m_resource_manager.num_pending_textures() > 0) {
+        render_placeholder_text("Loading the texture...");
     } else {
-        render_placeholder_text();
+        render_placeholder_text("No texture loaded. Please insert a texture.");
     }
 }
 
@@ -336,11 +400,10 @@ void Viewport::render_cursor_hud() {
     }
 }
 
-void Viewport::render_placeholder_text() {
+void Viewport::render_placeholder_text(const char* placeholder_text) {
     auto font =
         m_resource_manager.get_font(std::string(RESOURCE_DIR) + "/fonts/PixelifySans-Regular.ttf");
     if (font != nullptr) {
-        const char* placeholder_text = "No texture loaded. Please insert a texture.";
         SDL_Color text_color{255, 255, 255, 255};
         SDL_Surface* text_surface =
             TTF_RenderText_Blended(font.get()->get(), placeholder_text, text_color);
@@ -448,11 +511,11 @@ void Viewport::render_frames() const {
         SDL_RenderDrawRect(m_renderer.get(), &render_frame_rect);
     }
 
-    if (m_is_previewing) {
+    if (m_is_previewing && m_preview != nullptr) {
         SDL_SetRenderDrawColor(m_renderer.get(), preview_frame_color.r, preview_frame_color.g,
                                preview_frame_color.b, preview_frame_color.a);
 
-        for (const auto& frame : m_preview_frames) {
+        for (const auto& frame : m_preview->frames) {
             SDL_Rect render_frame_rect{static_cast<int>((frame.x + offset.x) * scale),
                                        static_cast<int>((frame.y + offset.y) * scale),
                                        static_cast<int>(frame.w * scale),
@@ -462,6 +525,35 @@ void Viewport::render_frames() const {
     }
 }
 
+void Viewport::render_component_preview() {
+    static const SDL_Color preview_frame_color{255, 215, 0, 155};
+
+    auto texture = m_state.texture_sprite.texture();
+    if (texture == nullptr || !texture->is_loaded()) return;
+
+    // Every sprite AUTO_EXTRACT would pick with the current settings
+    m_preview_extractor.request(texture->snapshot(), {0, 0, texture->width(), texture->height()},
+                                m_state.extraction_settings);
+    if (m_preview == nullptr) return;
+
+    const float scale = m_state.zoom_state.current_scale;
+    const ImVec2 offset = m_state.pan_state.current_offset;
+
+    std::vector<SDL_Rect> render_rects;
+    render_rects.reserve(m_preview->frames.size());
+    for (const rendering::Frame& frame : m_preview->frames) {
+        render_rects.push_back({static_cast<int>((frame.x + offset.x) * scale),
+                                static_cast<int>((frame.y + offset.y) * scale),
+                                static_cast<int>(frame.w * scale),
+                                static_cast<int>(frame.h * scale)});
+    }
+
+    SDL_SetRenderDrawColor(m_renderer.get(), preview_frame_color.r, preview_frame_color.g,
+                           preview_frame_color.b, preview_frame_color.a);
+    SDL_RenderDrawRects(m_renderer.get(), render_rects.data(),
+                        static_cast<int>(render_rects.size()));
+}
+
 void Viewport::handle_click(float x, float y) {
     float world_x = (x / m_state.zoom_state.current_scale) - m_state.pan_state.current_offset.x;
     float world_y = (y / m_state.zoom_state.current_scale) - m_state.pan_state.current_offset.y;
@@ -478,18 +570,32 @@ void Viewport::handle_click(float x, float y) {
                 sprite.set_selected(true);
                 break;
             case tools::Tool::COLOR_SWAP: {
+                // Only pick the source color, the swap itself runs once the threshold is
+                // committed from the color swap panel
                 SDL_Color pixel_color = get_texture_pixel_color(
                     static_cast<int>(texture_x), static_cast<int>(texture_y), sprite);
-                commands::SwapTextureCommand command(
-                    pixel_color,
-                    SDL_Color{
-                        static_cast<Uint8>(m_state.replacement_color[0] * 255),
-                        static_cast<Uint8>(m_state.replacement_color[1] * 255),
-                        static_cast<Uint8>(m_state.replacement_color[2] * 255),
-                        static_cast<Uint8>(m_state.replacement_color[3] * 255),
-                    },
-                    m_state.texture_sprite.texture());
-                command.execute();
+                m_color_swap_preview.pick(sprite.texture(), pixel_color);
+            } break;
+            case tools::Tool::AUTO_EXTRACT: {
+                std::string animation_name = m_animation_manager.current_animation_name();
+                if (animation_name.empty()) {
+                    core::Logger::warn("Select an animation to extract the frames into");
+                    break;
+                }
+
+                bool should_append = ImGui::IsKeyDown(ImGuiKey_LeftShift);
+                std::function<void()> on_done;
+                if (!should_append) {
+                    on_done = [this] {
+                        m_state.animation_state.current_frame = 0;
+                        m_state.animation_state.selected_frames.clear();
+                    };
+                }
+                m_command_executor.submit(
+                    std::make_unique<commands::AutoExtractCommand>(
+                        sprite.texture(), m_animation_manager, animation_name, should_append,
+                        m_state.extraction_settings, &m_history),
+                    commands::CommandPriority::NORMAL, std::move(on_done));
             } break;
             default:
                 break;
@@ -499,30 +605,184 @@ void Viewport::handle_click(float x, float y) {
     }
 }
 
-SDL_Color Viewport::get_texture_pixel_color(int x, int y, const rendering::Sprite& sprite) {
-    SDL_Texture* texture = sprite.texture()->get();
-    void* pixels = nullptr;
-    int pitch = 0;
+void Viewport::record(commands::FramesEdit&& edit) {
+    if (edit.empty()) return;
+    m_history.push(std::make_unique<commands::FramesEdit>(std::move(edit)));
+}
 
-    if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) {
-        core::Logger::error("Failed to lock texture: %s", SDL_GetError());
+SDL_Color Viewport::get_texture_pixel_color(int x, int y, const rendering::Sprite& sprite) {
+    rendering::PixelView pixels = sprite.texture()->pixels();
+    if (pixels.empty() || x < 0 || y < 0 || x >= pixels.width || y >= pixels.height) {
         return SDL_Color{0, 0, 0, 0};
     }
 
-    Uint32 format;
-    SDL_QueryTexture(texture, &format, nullptr, nullptr, nullptr);
-    SDL_PixelFormat* pixel_format = SDL_AllocFormat(format);
+    uint32_t pixel = pixels.at(x, y);
+    return SDL_Color{static_cast<Uint8>(pixel >> 24), static_cast<Uint8>(pixel >> 16),
+                     static_cast<Uint8>(pixel >> 8), static_cast<Uint8>(pixel)};
+}
+
+void Viewport::commit_color_swap() {
+    if (!m_color_swap_preview.is_active()) return;
+
+    auto command = std::make_unique<commands::SwapTextureCommand>(
+        m_color_swap_preview.color(), replacement_color(), m_color_swap_preview.texture(),
+        static_cast<uint8_t>(std::clamp(m_state.color_swap_state.threshold, 0, 255)),
+        &m_history);
+    m_command_executor.submit(std::move(command));
+
+    // The distances were computed against the previous pixels
+    m_color_swap_preview.clear();
+}
+
+SDL_Color Viewport::replacement_color() const {
+    return SDL_Color{
+        static_cast<Uint8>(m_state.replacement_color[0] * 255),
+        static_cast<Uint8>(m_state.replacement_color[1] * 255),
+        static_cast<Uint8>(m_state.replacement_color[2] * 255),
+        static_cast<Uint8>(m_state.replacement_color[3] * 255),
+    };
+}
+
+void Viewport::add_palette_swap() {
+    if (!m_color_swap_preview.is_active()) return;
+
+    commands::PaletteSwap swap;
+    swap.from = m_color_swap_preview.color();
+    swap.to = replacement_color();
+    swap.threshold = static_cast<uint8_t>(std::clamp(m_state.color_swap_state.threshold, 0, 255));
+    m_palette.push_back(swap);
+
+    m_color_swap_preview.clear();
+}
+
+void Viewport::commit_palette() {
+    std::shared_ptr<rendering::Texture2D> texture = m_state.texture_sprite.texture();
+    if (m_palette.empty() || texture == nullptr || !texture->is_loaded()) return;
+
+    m_command_executor.submit(
+        std::make_unique<commands::PaletteRemapCommand>(m_palette, texture, &m_history));
+    // Whatever the preview showed is about to change
+    m_color_swap_preview.clear();
+}
+
+void Viewport::render_palette() {
+    ImGui::Separator();
+    ImGui::TextUnformatted("Palette");
+    if (m_palette.empty()) {
+        ImGui::TextDisabled("Add picked colors to recolor them all at once");
+        return;
+    }
+
+    auto to_imgui = [](const SDL_Color& color) {
+        return ImVec4(color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f);
+    };
+
+    for (size_t i = 0; i < m_palette.size();) {
+        commands::PaletteSwap& swap = m_palette[i];
+        ImGui::PushID(static_cast<int>(i));
+
+        ImGui::ColorButton("##From", to_imgui(swap.from));
+        ImGui::SameLine();
+        ImGui::TextUnformatted(ICON_FA_ARROW_RIGHT);
+        ImGui::SameLine();
+        float to[4] = {swap.to.r / 255.0f, swap.to.g / 255.0f, swap.to.b / 255.0f,
+                       swap.to.a / 255.0f};
+        if (ImGui::ColorEdit4("##To", to,
+                              ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_AlphaBar)) {
+            swap.to = SDL_Color{static_cast<Uint8>(to[0] * 255), static_cast<Uint8>(to[1] * 255),
+                                static_cast<Uint8>(to[2] * 255), static_cast<Uint8>(to[3] * 255)};
+        }
+        ImGui::SameLine();
+        int threshold = swap.threshold;
+        ImGui::SetNextItemWidth(120.0f);
+        if (ImGui::SliderInt("##Threshold", &threshold, 0, 255)) {
+            swap.threshold = static_cast<uint8_t>(threshold);
+        }
+        ImGui::SameLine();
+        const bool removed = ImGui::Button(ICON_FA_TRASH);
+
+        ImGui::PopID();
+        if (removed) {
+            m_palette.erase(m_palette.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            ++i;
+        }
+    }
+
+    if (ImGui::Button(ICON_FA_PAINT_BRUSH " Apply palette")) {
+        commit_palette();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(ICON_FA_TIMES " Clear")) {
+        m_palette.clear();
+    }
+}
+
+void Viewport::render_color_swap_panel() {
+    ImGui::SetNextWindowPos(ImVec2(15, 80), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Color Swap", nullptr,
+                 ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(5, 5));
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(5, 5));
+
+    if (m_color_swap_preview.is_active()) {
+        const SDL_Color& color = m_color_swap_preview.color();
+        ImGui::ColorButton("##SourceColor",
+                           ImVec4(color.r / 255.0f, color.g / 255.0f, color.b / 255.0f,
+                                  color.a / 255.0f));
+        ImGui::SameLine();
+        ImGui::Text("(%d, %d, %d, %d)", color.r, color.g, color.b, color.a);
+    } else {
+        ImGui::TextDisabled("Click on the texture to pick a color");
+    }
+
+    ImGui::ColorEdit4("Replacement", m_state.replacement_color);
+    ImGui::SliderInt("Threshold", &m_state.color_swap_state.threshold, 0, 255);
 
-    Uint8* pixel_ptr = static_cast<Uint8*>(pixels) + y * pitch + x * 4;
-    Uint32 pixel_value = *(reinterpret_cast<Uint32*>(pixel_ptr));
+    if (m_color_swap_preview.is_active()) {
+        ImGui::Text("%zu pixels affected", m_color_swap_preview.num_affected());
 
-    SDL_Color color;
-    SDL_GetRGBA(pixel_value, pixel_format, &color.r, &color.g, &color.b, &color.a);
+        if (ImGui::Button(ICON_FA_CHECK " Apply")) {
+            commit_color_swap();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_PLUS " Add to palette")) {
+            add_palette_swap();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_TIMES " Cancel")) {
+            m_color_swap_preview.clear();
+        }
+    }
 
-    SDL_UnlockTexture(texture);
-    SDL_FreeFormat(pixel_format);
+    render_palette();
 
-    return color;
+    ImGui::PopStyleVar(2);
+    ImGui::End();
+}
+
+void Viewport::render_extraction_panel() {
+    ImGui::SetNextWindowPos(ImVec2(15, 80), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Extraction", nullptr,
+                 ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(5, 5));
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(5, 5));
+
+    extraction::ExtractionSettings& settings = m_state.extraction_settings;
+    ImGui::SliderInt("Threshold", &settings.threshold, 0, 255);
+    ImGui::SliderInt("Merge radius", &settings.dilation, 0,
+                     extraction::DistanceField::k_max_distance);
+
+    // Moving the merge radius only thresholds the cached distance field again, the count
+    // follows once the background extraction catches up
+    if (m_preview != nullptr) {
+        ImGui::Text("%zu sprites", m_preview->num_components);
+    }
+
+    ImGui::PopStyleVar(2);
+    ImGui::End();
 }
 
 void Viewport::render_toolbar() {
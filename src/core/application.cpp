@@ -5,6 +5,8 @@
 #include <imgui_impl_sdlrenderer2.h>
 #include <imgui_internal.h>
 
+#include <algorithm>
+#include <command/command_executor.hpp>
 #include <command/export_texture_command.hpp>
 #include <command/load_command.hpp>
 #include <command/save_command.hpp>
@@ -12,10 +14,13 @@
 #include <core/config.hpp>
 #include <core/logger.hpp>
 #include <core/state.hpp>
+#include <core/thread_pool.hpp>
+#include <filesystem>
 #include <layers/editor_layer.hpp>
 #include <managers/resource_manager.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace piksy {
 namespace core {
@@ -31,6 +36,7 @@ void Application::run() {
             continue;
         }
 
+        wait_for_events();
         handle_events();
         update();
         render();
@@ -55,16 +61,33 @@ void Application::init() {
     m_window.init(m_config.window_config);
     m_renderer.init(m_window, m_config.window_config);
     m_gui_system.init(m_config.imgui_config, m_window, m_renderer);
+    m_resource_manager.set_texture_budget(m_config.app_config.texture_budget);
+    m_resource_manager.set_pixel_cache(m_config.app_config.pixel_cache_dir,
+                                       m_config.app_config.pixel_cache_budget);
+    // The tiles recorded before a reload would paste the old pixels back
+    m_resource_manager.set_on_texture_reloaded(
+        [this](const rendering::Texture2D *texture) { m_history.forget(texture); });
 
     m_io = &ImGui::GetIO();
     (void)*m_io;
 
+    // A background job finishing is an event too, the idle loop wakes up to show its result
+    m_wakeup_event = SDL_RegisterEvents(1);
+    if (m_wakeup_event != static_cast<Uint32>(-1)) {
+        ThreadPool::global().set_main_thread_wakeup([type = m_wakeup_event] {
+            SDL_Event event{};
+            event.type = type;
+            SDL_PushEvent(&event);
+        });
+    }
+
     init_textures();
     init_fonts();
     init_state();
 
     m_layer_stack.push_layer<layers::EditorLayer>(m_renderer, m_state, m_resource_manager,
-                                                  m_animation_manager);
+                                                  m_animation_manager, m_command_executor,
+                                                  m_history);
 
     Logger::info("Successfully initialized the application !");
 }
@@ -87,6 +110,10 @@ void Application::init_state() {
 }
 
 void Application::cleanup() {
+    m_command_executor.shutdown();
+    ThreadPool::global().set_main_thread_wakeup(nullptr);
+    // The edits keep their textures alive, they go before the renderer does
+    m_history.clear();
     m_resource_manager.cleanup();
 
     m_gui_system.cleanup();
@@ -96,12 +123,39 @@ void Application::cleanup() {
     core::Logger::debug("Application successfully cleaned up");
 }
 
+bool Application::is_animating() const {
+    return m_state.animation_state.is_playing || !m_state.zoom_state.is_settled() ||
+           !m_state.pan_state.is_settled() || m_command_executor.is_busy() ||
+           m_resource_manager.num_pending_textures() > 0;
+}
+
+void Application::wait_for_events() {
+    if (!m_config.app_config.idle_redraw || is_animating()) return;
+
+    // ImGui settles hover states and layout over a few frames after an input
+    if (m_num_settling_frames > 0) {
+        --m_num_settling_frames;
+        return;
+    }
+    // Leaves the event in the queue for handle_events(). Background jobs and the file watcher
+    // push a wakeup event once they have something to show.
+    if (m_wakeup_event == static_cast<Uint32>(-1)) {
+        SDL_WaitEventTimeout(nullptr, k_fallback_wait_ms);
+    } else {
+        SDL_WaitEvent(nullptr);
+    }
+}
+
 void Application::handle_events() {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
+        m_num_settling_frames = k_settling_frames;
+        if (event.type == m_wakeup_event) continue;
+
         ImGui_ImplSDL2_ProcessEvent(&event);
         if (event.type == SDL_QUIT) {
             // TODO: Configure this `Save on Exit`
+            m_command_executor.shutdown();
             commands::SaveCommand command(m_config.app_config.save_file, m_state,
                                           m_animation_manager);
             command.execute();
@@ -112,6 +166,7 @@ void Application::handle_events() {
         if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE &&
             event.window.windowID == SDL_GetWindowID(m_window.get())) {
             // TODO: Configure this `Save on Exit`
+            m_command_executor.shutdown();
             commands::SaveCommand command(m_config.app_config.save_file, m_state,
                                           m_animation_manager);
             command.execute();
@@ -141,6 +196,12 @@ void Application::update() {
     m_state.delta_time = delta_time;
     m_state.fps = 1.0f / delta_time;
 
+    // Continuations of the background jobs that finished since the last frame
+    ThreadPool::global().run_main_thread_tasks();
+    m_command_executor.update();
+    m_resource_manager.update();
+    handle_shortcuts();
+
     for (auto &layer : m_layer_stack.layers()) {
         layer->on_update(delta_time);
     }
@@ -195,21 +256,25 @@ void Application::render() {
             if (ImGui::BeginMenuBar()) {
                 if (ImGui::BeginMenu("File")) {
                     if (ImGui::MenuItem("Open...", "Ctrl+O")) {
-                        commands::LoadCommand command(m_config.app_config.save_file, m_state,
-                                                      m_resource_manager, m_animation_manager);
-                        command.execute();
+                        m_command_executor.submit(
+                            std::make_unique<commands::LoadCommand>(
+                                m_config.app_config.save_file, m_state, m_resource_manager,
+                                m_animation_manager, &m_history),
+                            commands::CommandPriority::HIGH);
                     }
                     if (ImGui::MenuItem("Save", "Cmd+S")) {
-                        commands::SaveCommand command(m_config.app_config.save_file, m_state,
-                                                      m_animation_manager);
-                        command.execute();
+                        m_command_executor.submit(
+                            std::make_unique<commands::SaveCommand>(m_config.app_config.save_file,
+                                                                    m_state, m_animation_manager),
+                            commands::CommandPriority::HIGH);
                     }
 
                     if (ImGui::MenuItem("Export Texture as PNG...")) {
                         fs::path export_path = "./exported_texture.png";
 
-                        commands::ExportTextureCommand export_cmd(m_state, export_path);
-                        export_cmd.execute();
+                        m_command_executor.submit(
+                            std::make_unique<commands::ExportTextureCommand>(m_state, export_path),
+                            commands::CommandPriority::LOW);
                     }
 
                     if (ImGui::MenuItem("Exit", "Alt+F4")) {
@@ -218,11 +283,30 @@ void Application::render() {
                     ImGui::EndMenu();
                 }
                 if (ImGui::BeginMenu("Edit")) {
-                    // TODO: Add edit menu items here
+                    const commands::Edit *next_undo = m_history.next_undo();
+                    std::string undo_label =
+                        next_undo ? std::string("Undo ") + next_undo->name() : "Undo";
+                    if (ImGui::MenuItem(undo_label.c_str(), "Ctrl+Z", false, next_undo)) {
+                        undo();
+                    }
+
+                    const commands::Edit *next_redo = m_history.next_redo();
+                    std::string redo_label =
+                        next_redo ? std::string("Redo ") + next_redo->name() : "Redo";
+                    if (ImGui::MenuItem(redo_label.c_str(), "Ctrl+Shift+Z", false, next_redo)) {
+                        redo();
+                    }
+
+                    ImGui::Separator();
+                    ImGui::MenuItem("History", nullptr, false, false);
+                    ImGui::TextDisabled("%.1f MB", m_history.num_bytes() / (1024.0f * 1024.0f));
                     ImGui::EndMenu();
                 }
                 if (ImGui::BeginMenu("Tools")) {
-                    // TODO: Add tools menu items here
+                    if (ImGui::BeginMenu("Texture Cache")) {
+                        render_texture_cache();
+                        ImGui::EndMenu();
+                    }
                     ImGui::EndMenu();
                 }
                 if (ImGui::BeginMenu("Help")) {
@@ -252,6 +336,7 @@ void Application::render() {
                     auto &[level, message] = Logger::messages().back();
                     ImGui::Text("%s", message.c_str());
                 }
+                render_command_status();
                 ImGui::EndMenuBar();
             }
             ImGui::End();
@@ -274,5 +359,70 @@ void Application::render() {
     SDL_RenderPresent(m_renderer.get());
 }
 
+void Application::handle_shortcuts() {
+    ImGuiIO &io = ImGui::GetIO();
+    if (io.WantTextInput || !(io.KeyCtrl || io.KeySuper)) return;
+
+    if (ImGui::IsKeyPressed(ImGuiKey_Z, false)) {
+        io.KeyShift ? redo() : undo();
+    } else if (ImGui::IsKeyPressed(ImGuiKey_Y, false)) {
+        redo();
+    }
+}
+
+void Application::undo() {
+    m_history.undo();
+    // The frames may not be where the selection expects them anymore
+    m_state.animation_state.current_frame = 0;
+    m_state.animation_state.selected_frames.clear();
+}
+
+void Application::redo() {
+    m_history.redo();
+    m_state.animation_state.current_frame = 0;
+    m_state.animation_state.selected_frames.clear();
+}
+
+void Application::render_command_status() {
+    std::vector<commands::CommandStatus> statuses = m_command_executor.status();
+    if (statuses.empty()) return;
+
+    // Right aligned, the running command with its progress and the size of the queue
+    const commands::CommandStatus &current = statuses.front();
+    const float width = 320.0f;
+    ImGui::SameLine(std::max(ImGui::GetCursorPosX(), ImGui::GetWindowWidth() - width));
+
+    ImGui::Text("%s", current.name.c_str());
+    ImGui::SameLine();
+    ImGui::ProgressBar(current.is_running ? current.progress : 0.0f, ImVec2(120.0f, 0.0f));
+    if (statuses.size() > 1) {
+        ImGui::SameLine();
+        ImGui::Text("+%zu", statuses.size() - 1);
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Cancel")) {
+        m_command_executor.cancel(current.id);
+    }
+}
+
+void Application::render_texture_cache() {
+    const float mb = 1024.0f * 1024.0f;
+
+    int budget_mb = static_cast<int>(m_resource_manager.texture_budget() / (1024 * 1024));
+    if (ImGui::SliderInt("Budget", &budget_mb, 64, 4096, "%d MB")) {
+        m_resource_manager.set_texture_budget(static_cast<size_t>(budget_mb) * 1024 * 1024);
+    }
+    ImGui::TextDisabled("%.1f MB cached", m_resource_manager.num_texture_bytes() / mb);
+    ImGui::Separator();
+
+    // Most recently used first, the ones at the bottom go first once over budget
+    for (const auto &info : m_resource_manager.texture_infos()) {
+        const std::string name = std::filesystem::path(info.path).filename().string();
+        ImGui::Text("%s", name.c_str());
+        ImGui::SameLine(220.0f);
+        ImGui::TextDisabled("%.1f MB%s", info.num_bytes / mb, info.in_use ? " (in use)" : "");
+    }
+}
+
 }  // namespace core
 }  // namespace piksy
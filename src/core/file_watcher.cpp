@@ -0,0 +1,170 @@
+#include <core/file_watcher.hpp>
+#include <core/logger.hpp>
+#include <core/thread_pool.hpp>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace piksy {
+namespace core {
+
+namespace {
+
+// How long the watcher thread sleeps between two checks, bounds how long stopping it takes
+constexpr int k_wait_ms = 100;
+
+}  // namespace
+
+FileWatcher::FileWatcher(std::chrono::milliseconds debounce) : m_debounce(debounce) {
+#if defined(__linux__)
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd < 0) {
+        core::Logger::warn("Failed to start watching files, hot reload is disabled");
+        return;
+    }
+#endif
+    m_thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher() {
+    m_running = false;
+    if (m_thread.joinable()) m_thread.join();
+#if defined(__linux__)
+    if (m_inotify_fd >= 0) ::close(m_inotify_fd);
+#endif
+}
+
+void FileWatcher::watch(const std::string &path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_files.insert(path).second) return;
+
+#if defined(__linux__)
+    if (m_inotify_fd < 0) return;
+
+    const std::string directory = fs::path(path).parent_path().string();
+    if (m_directory_watches.count(directory)) return;
+
+    int watch = inotify_add_watch(m_inotify_fd, directory.c_str(),
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch < 0) {
+        core::Logger::warn("Failed to watch the directory %s", directory.c_str());
+        return;
+    }
+    m_directories[watch] = directory;
+    m_directory_watches[directory] = watch;
+#else
+    std::error_code error;
+    auto mtime = fs::last_write_time(path, error);
+    m_modification_times[path] = error ? 0 : mtime.time_since_epoch().count();
+#endif
+}
+
+void FileWatcher::unwatch(const std::string &path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_files.erase(path) == 0) return;
+    m_changes.erase(path);
+
+#if defined(__linux__)
+    // Stop watching the directory once no watched file is left in it
+    const fs::path directory = fs::path(path).parent_path();
+    for (const std::string &file : m_files) {
+        if (fs::path(file).parent_path() == directory) return;
+    }
+
+    auto it = m_directory_watches.find(directory.string());
+    if (it == m_directory_watches.end()) return;
+    inotify_rm_watch(m_inotify_fd, it->second);
+    m_directories.erase(it->second);
+    m_directory_watches.erase(it);
+#else
+    m_modification_times.erase(path);
+#endif
+}
+
+std::vector<std::string> FileWatcher::poll_changes() {
+    std::vector<std::string> changed;
+    const Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_changes.begin(); it != m_changes.end();) {
+        if (now - it->second >= m_debounce) {
+            changed.push_back(it->first);
+            it = m_changes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return changed;
+}
+
+void FileWatcher::on_changed(const std::string &path) {
+    // Called with the mutex held
+    if (m_files.count(path)) m_changes[path] = Clock::now();
+}
+
+void FileWatcher::run() {
+    while (m_running) {
+#if defined(__linux__)
+        pollfd descriptor{m_inotify_fd, POLLIN, 0};
+        if (::poll(&descriptor, 1, k_wait_ms) > 0) read_events();
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(k_wait_ms * 5));
+        poll_modification_times();
+#endif
+        wake_when_ready();
+    }
+}
+
+void FileWatcher::wake_when_ready() {
+    const Clock::time_point now = Clock::now();
+    bool is_ready = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[path, time] : m_changes) {
+            const Clock::time_point ready = time + m_debounce;
+            if (ready <= now && ready > m_last_wakeup) is_ready = true;
+        }
+        if (is_ready) m_last_wakeup = now;
+    }
+    // poll_changes() runs on the next frame
+    if (is_ready) ThreadPool::global().wake_main_thread();
+}
+
+#if defined(__linux__)
+void FileWatcher::read_events() {
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = ::read(m_inotify_fd, buffer, sizeof(buffer))) > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (char *cursor = buffer; cursor < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            auto directory = m_directories.find(event->wd);
+            if (directory == m_directories.end() || event->len == 0) continue;
+            on_changed((fs::path(directory->second) / event->name).string());
+        }
+    }
+}
+#else
+void FileWatcher::poll_modification_times() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &[path, modification_time] : m_modification_times) {
+        std::error_code error;
+        auto mtime = fs::last_write_time(path, error);
+        if (error || mtime.time_since_epoch().count() == modification_time) continue;
+
+        modification_time = mtime.time_since_epoch().count();
+        on_changed(path);
+    }
+}
+#endif
+
+}  // namespace core
+}  // namespace piksy
@@ -0,0 +1,211 @@
+#include <core/logger.hpp>
+#include <core/thread_pool.hpp>
+#include <exception>
+
+namespace piksy {
+namespace core {
+
+namespace {
+
+// Pool and queue of the worker running on this thread, if any
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local size_t t_worker = 0;
+
+// A task throwing must not take the editor down with it, nobody is left to handle the error
+void run_task(const std::function<void()>& task) {
+    try {
+        task();
+    } catch (const std::exception& ex) {
+        Logger::error("A background task failed: %s", ex.what());
+    } catch (...) {
+        Logger::error("A background task failed with an unknown error");
+    }
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    // The calling thread always takes part in the work, keep one core for it
+    num_threads = num_threads > 1 ? num_threads - 1 : 0;
+
+    for (size_t i = 0; i < num_threads + 1; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    m_workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_workers.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool instance;
+    return instance;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Single core machines have no worker, the task would never run otherwise
+    if (m_workers.empty()) {
+        run_task(task);
+        return;
+    }
+
+    // Counted before being pushed, so the count never drops below the number of queued tasks
+    ++m_num_queued;
+
+    // A worker keeps what it submits, it is probably needed soon and still in its cache
+    Queue& queue = *m_queues[t_pool == this ? t_worker : m_queues.size() - 1];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the push before the check of a worker about to sleep
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_condition.notify_one();
+}
+
+bool ThreadPool::pop_task(size_t index, std::function<void()>& task) {
+    auto try_pop = [&](Queue& queue, bool newest) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        if (newest) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        --m_num_queued;
+        return true;
+    };
+
+    // Own queue first, then the shared one, then steal from the others starting with the next
+    // worker so the thieves spread out. m_workers may still be filling up, the queues are not.
+    const size_t num_workers = m_queues.size() - 1;
+    if (try_pop(*m_queues[index], true)) return true;
+    if (try_pop(*m_queues[num_workers], false)) return true;
+    for (size_t i = 1; i < num_workers; ++i) {
+        if (try_pop(*m_queues[(index + i) % num_workers], false)) return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    t_pool = this;
+    t_worker = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (pop_task(index, task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_stopping || m_num_queued.load() > 0; });
+        if (m_stopping && m_num_queued.load() == 0) return;
+    }
+}
+
+void ThreadPool::post_to_main(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_main_mutex);
+        m_main_tasks.push_back(std::move(task));
+    }
+    wake_main_thread();
+}
+
+void ThreadPool::run_main_thread_tasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_main_mutex);
+        tasks.swap(m_main_tasks);
+    }
+    // The tasks may post more, those run on the next frame
+    for (auto& task : tasks) task();
+}
+
+void ThreadPool::set_main_thread_wakeup(std::function<void()> wakeup) {
+    std::lock_guard<std::mutex> lock(m_main_mutex);
+    m_main_wakeup = std::move(wakeup);
+}
+
+void ThreadPool::wake_main_thread() {
+    std::function<void()> wakeup;
+    {
+        std::lock_guard<std::mutex> lock(m_main_mutex);
+        wakeup = m_main_wakeup;
+    }
+    if (wakeup) wakeup();
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : m_pool(pool), m_shared(std::make_shared<Shared>()) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // Only wait() reports the errors of the tasks
+    }
+}
+
+bool TaskGroup::Shared::run_one() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+        ++num_running;
+    }
+
+    std::exception_ptr task_error;
+    try {
+        task();
+    } catch (...) {
+        task_error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (task_error && !error) error = task_error;
+    if (--num_running == 0 && tasks.empty()) done.notify_all();
+    return true;
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        m_shared->tasks.push_back(std::move(task));
+    }
+    m_pool.submit([shared = m_shared] { shared->run_one(); });
+}
+
+void TaskGroup::wait() {
+    while (m_shared->run_one()) {
+    }
+
+    std::unique_lock<std::mutex> lock(m_shared->mutex);
+    m_shared->done.wait(lock,
+                        [&] { return m_shared->tasks.empty() && m_shared->num_running == 0; });
+    if (m_shared->error) {
+        std::exception_ptr error = m_shared->error;
+        m_shared->error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace core
+}  // namespace piksy
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <core/thread_pool.hpp>
+#include <extraction/bit_mask.hpp>
+
+namespace piksy {
+namespace extraction {
+
+namespace {
+
+// Word `i` of a row shifted towards higher pixels by `shift`: pixel x takes pixel x - shift
+uint64_t shifted_up(const uint64_t *words, int num_words, int i, int shift) {
+    int source = i - (shift >> 6), bits = shift & 63;
+    uint64_t word = source >= 0 && source < num_words ? words[source] << bits : 0;
+    if (bits != 0 && source - 1 >= 0 && source - 1 < num_words) {
+        word |= words[source - 1] >> (64 - bits);
+    }
+    return word;
+}
+
+// Word `i` of a row shifted towards lower pixels by `shift`: pixel x takes pixel x + shift
+uint64_t shifted_down(const uint64_t *words, int num_words, int i, int shift) {
+    int source = i + (shift >> 6), bits = shift & 63;
+    uint64_t word = source >= 0 && source < num_words ? words[source] >> bits : 0;
+    if (bits != 0 && source + 1 >= 0 && source + 1 < num_words) {
+        word |= words[source + 1] << (64 - bits);
+    }
+    return word;
+}
+
+// Rows per parallel chunk, aiming for ~64K words
+int rows_per_chunk(int words_per_row) { return std::max(1, (1 << 16) / words_per_row); }
+
+}  // namespace
+
+BitMask::BitMask(int width, int height)
+    : m_width(std::max(width, 0)),
+      m_height(std::max(height, 0)),
+      m_words_per_row((m_width + 63) / 64),
+      m_words(static_cast<size_t>(m_words_per_row) * m_height, 0) {}
+
+void BitMask::set(int x, int y, bool value) {
+    uint64_t bit = uint64_t{1} << (x & 63);
+    uint64_t &word = row(y)[x >> 6];
+    word = value ? word | bit : word & ~bit;
+}
+
+size_t BitMask::count() const {
+    size_t num_set = 0;
+    for (uint64_t word : m_words) num_set += __builtin_popcountll(word);
+    return num_set;
+}
+
+void BitMask::clear_padding(int y) {
+    if (m_width & 63) row(y)[m_words_per_row - 1] &= (uint64_t{1} << (m_width & 63)) - 1;
+}
+
+int BitMask::find_change(int x, int y, bool value) const {
+    if (x >= m_width) return m_width;
+
+    const uint64_t *words = row(y);
+    const uint64_t flip = value ? ~uint64_t{0} : 0;
+    int i = x >> 6;
+    // Pixels before `x` in the first word are ignored
+    uint64_t changes = (words[i] ^ flip) & (~uint64_t{0} << (x & 63));
+    while (changes == 0) {
+        if (++i == m_words_per_row) return m_width;
+        changes = words[i] ^ flip;
+    }
+    return std::min(i * 64 + __builtin_ctzll(changes), m_width);
+}
+
+void BitMask::dilate(int radius) {
+    if (empty() || radius <= 0) return;
+    dilate_rows(radius);
+    dilate_columns(radius);
+}
+
+void BitMask::erode(int radius) {
+    if (empty() || radius <= 0) return;
+    // Eroding the set pixels is dilating the unset ones, the outside being unset after inversion
+    invert();
+    dilate(radius);
+    invert();
+}
+
+void BitMask::invert() {
+    core::ThreadPool::global().parallel_for(
+        0, m_height, rows_per_chunk(m_words_per_row), [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y) {
+                uint64_t *words = row(y);
+                for (int i = 0; i < m_words_per_row; ++i) words[i] = ~words[i];
+                clear_padding(y);
+            }
+        });
+}
+
+// Each pass ORs the row with itself shifted both ways by `step`. In a row already dilated by
+// `covered` every set span is at least covered + 1 wide (the spans clipped by the row ends are
+// the narrowest), so shifting by up to that much keeps the spans contiguous and the radius
+// doubles every pass.
+void BitMask::dilate_rows(int radius) {
+    core::ThreadPool::global().parallel_for(
+        0, m_height, rows_per_chunk(m_words_per_row), [&](int row_begin, int row_end) {
+            std::vector<uint64_t> source(m_words_per_row);
+            for (int y = row_begin; y < row_end; ++y) {
+                uint64_t *words = row(y);
+                for (int covered = 0; covered < radius;) {
+                    int step = std::min(covered + 1, radius - covered);
+                    std::copy(words, words + m_words_per_row, source.begin());
+                    for (int i = 0; i < m_words_per_row; ++i) {
+                        words[i] = source[i] |
+                                   shifted_up(source.data(), m_words_per_row, i, step) |
+                                   shifted_down(source.data(), m_words_per_row, i, step);
+                    }
+                    covered += step;
+                }
+                clear_padding(y);
+            }
+        });
+}
+
+void BitMask::dilate_columns(int radius) {
+    std::vector<uint64_t> source = m_words;
+    core::ThreadPool::global().parallel_for(
+        0, m_height, rows_per_chunk(m_words_per_row), [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y) {
+                uint64_t *words = row(y);
+                int first = std::max(y - radius, 0), last = std::min(y + radius, m_height - 1);
+                std::fill(words, words + m_words_per_row, 0);
+                for (int other = first; other <= last; ++other) {
+                    const uint64_t *other_words =
+                        source.data() + static_cast<size_t>(other) * m_words_per_row;
+                    for (int i = 0; i < m_words_per_row; ++i) words[i] |= other_words[i];
+                }
+            }
+        });
+}
+
+}  // namespace extraction
+}  // namespace piksy
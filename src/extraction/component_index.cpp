@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <core/logger.hpp>
+#include <extraction/component_index.hpp>
+
+namespace piksy {
+namespace extraction {
+
+bool ComponentIndex::update(const rendering::PixelSnapshot &pixels,
+                            const ExtractionSettings &settings, const CancelCheck &is_cancelled) {
+    if (pixels.empty()) {
+        clear();
+        return true;
+    }
+
+    const bool same_pixels = m_version == pixels.version;
+    if (same_pixels && m_settings == settings) return true;
+
+    // Checked between the passes too, a half built mask or index must not be kept
+    auto cancelled = [&] {
+        if (!is_cancelled || !is_cancelled()) return false;
+        clear();
+        return true;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    const bool new_mask = !same_pixels || m_settings.threshold != settings.threshold;
+    if (new_mask) {
+        m_version = pixels.version;
+        m_mask = threshold_mask(pixels.pixels, settings.threshold, is_cancelled);
+        m_field = DistanceField();
+        if (cancelled()) return false;
+    }
+
+    if (!new_mask && settings.dilation <= DistanceField::k_max_distance) {
+        // Only the merge radius changed, it is a threshold on the distances to the sprites. The
+        // field is built the first time so a plain extraction never pays for it.
+        if (m_field.empty()) m_field = DistanceField(m_mask);
+        if (cancelled()) return false;
+        build(m_field.threshold(settings.dilation), is_cancelled);
+    } else {
+        BitMask dilated = m_mask;
+        dilated.dilate(settings.dilation);
+        if (cancelled()) return false;
+        build(dilated, is_cancelled);
+    }
+    if (cancelled()) return false;
+    m_settings = settings;
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                             start);
+    core::Logger::debug("Indexed %zu components in %.2f ms", m_components.size(), elapsed.count());
+    return true;
+}
+
+void ComponentIndex::clear() {
+    m_version = 0;
+    m_mask = BitMask();
+    m_field = DistanceField();
+    m_components.clear();
+    m_cells.clear();
+    m_columns = m_rows = 0;
+}
+
+void ComponentIndex::build(const BitMask &mask, const CancelCheck &is_cancelled) {
+    m_components.clear();
+    m_cells.clear();
+    m_columns = m_rows = 0;
+    if (mask.empty()) return;
+
+    for (const Component &component : label_mask(mask, is_cancelled)) {
+        m_components.push_back({component.x, component.y, component.w, component.h});
+    }
+    if (m_components.empty()) return;
+
+    m_columns = (mask.width() + k_cell_size - 1) / k_cell_size;
+    m_rows = (mask.height() + k_cell_size - 1) / k_cell_size;
+    m_cells.resize(static_cast<size_t>(m_columns) * m_rows);
+
+    for (uint32_t i = 0; i < m_components.size(); ++i) {
+        const SDL_Rect &component = m_components[i];
+        int column_end = (component.x + component.w - 1) / k_cell_size;
+        int row_end = (component.y + component.h - 1) / k_cell_size;
+        for (int row = component.y / k_cell_size; row <= row_end; ++row) {
+            for (int column = component.x / k_cell_size; column <= column_end; ++column) {
+                m_cells[static_cast<size_t>(row) * m_columns + column].push_back(i);
+            }
+        }
+    }
+}
+
+void ComponentIndex::query(const SDL_Rect &rect, std::vector<rendering::Frame> &out_frames) const {
+    out_frames.clear();
+    if (m_cells.empty() || rect.w <= 0 || rect.h <= 0) return;
+
+    int column_begin = std::max(rect.x / k_cell_size, 0);
+    int row_begin = std::max(rect.y / k_cell_size, 0);
+    int column_end = std::min((rect.x + rect.w - 1) / k_cell_size, m_columns - 1);
+    int row_end = std::min((rect.y + rect.h - 1) / k_cell_size, m_rows - 1);
+
+    for (int row = row_begin; row <= row_end; ++row) {
+        for (int column = column_begin; column <= column_end; ++column) {
+            for (uint32_t i : m_cells[static_cast<size_t>(row) * m_columns + column]) {
+                const SDL_Rect &component = m_components[i];
+
+                SDL_Rect clipped;
+                if (!SDL_IntersectRect(&component, &rect, &clipped)) continue;
+
+                // A component spans several cells, only the cell holding the top left corner of
+                // its overlap with the query reports it
+                if (clipped.x / k_cell_size != column || clipped.y / k_cell_size != row) continue;
+
+                out_frames.emplace_back(clipped.x, clipped.y, clipped.w, clipped.h);
+            }
+        }
+    }
+}
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <core/thread_pool.hpp>
+#include <cstring>
+#include <extraction/distance_field.hpp>
+
+namespace piksy {
+namespace extraction {
+
+namespace {
+
+constexpr uint8_t k_far = DistanceField::k_max_distance + 1;
+
+// Rows per parallel band: several per thread so they balance, and at least ~64K pixels. The
+// vertical passes recompute k_max_distance rows around each band, so bands stay well above that.
+int rows_per_band(int width, int height) {
+    int num_bands = static_cast<int>(core::ThreadPool::global().size() + 1) * 4;
+    return std::max({8 * DistanceField::k_max_distance, (1 << 16) / std::max(width, 1),
+                     (height + num_bands - 1) / num_bands});
+}
+
+// Distance along row `y` to the closest set pixel, saturated at k_far. Empty words far from
+// any set pixel are filled 64 pixels at a time.
+void row_distances(const BitMask &mask, int y, uint8_t *out) {
+    const uint64_t *words = mask.row(y);
+    const int width = mask.width();
+
+    uint8_t distance = k_far;
+    for (int x = 0; x < width; ++x) {
+        if ((x & 63) == 0 && words[x >> 6] == 0 && distance == k_far) {
+            int end = std::min(x + 64, width);
+            std::fill(out + x, out + end, k_far);
+            x = end - 1;
+            continue;
+        }
+        bool set = (words[x >> 6] >> (x & 63)) & 1;
+        distance = set ? 0 : std::min<uint8_t>(distance + 1, k_far);
+        out[x] = distance;
+    }
+
+    distance = k_far;
+    for (int x = width - 1; x >= 0; --x) {
+        distance = std::min<uint8_t>(distance + 1, out[x]);
+        out[x] = distance;
+    }
+}
+
+// out = min(out, min(previous[x - 1], previous[x], previous[x + 1]) + 1), where `previous` has
+// one k_far pixel of padding on each side
+void relax_row(const uint8_t *previous, int width, uint8_t *out) {
+    for (int x = 0; x < width; ++x) {
+        uint8_t closest = std::min(std::min(previous[x], previous[x + 1]), previous[x + 2]);
+        out[x] = std::min<uint8_t>(out[x], closest + 1);
+    }
+}
+
+}  // namespace
+
+// Two pass chamfer transform: exact along the rows first, then a pass down and a pass up
+// propagate the distances to the three neighbours of the next row, which is exact for the
+// chessboard metric. Rows past k_max_distance do not change a saturated field, so each band
+// restarts its vertical passes k_max_distance rows outside of itself and bands run in parallel.
+DistanceField::DistanceField(const BitMask &mask)
+    : m_width(mask.width()),
+      m_height(mask.height()),
+      m_distances(static_cast<size_t>(m_width) * m_height) {
+    if (empty()) return;
+
+    const int band_rows = rows_per_band(m_width, m_height);
+    const int halo = k_max_distance;
+    core::ThreadPool &pool = core::ThreadPool::global();
+
+    std::vector<uint8_t> rows(m_distances.size());
+    auto row_distance = [&](int y) { return rows.data() + static_cast<size_t>(y) * m_width; };
+    pool.parallel_for(0, m_height, band_rows, [&](int row_begin, int row_end) {
+        for (int y = row_begin; y < row_end; ++y) row_distances(mask, y, row_distance(y));
+    });
+
+    // Downwards: `rows` is only read, each band writes its own rows of the field
+    pool.parallel_for(0, m_height, band_rows, [&](int row_begin, int row_end) {
+        std::vector<uint8_t> previous(m_width + 2, k_far), current(m_width);
+        for (int y = std::max(row_begin - halo, 0); y < row_end; ++y) {
+            uint8_t *out = y >= row_begin ? row(y) : current.data();
+            std::copy(row_distance(y), row_distance(y) + m_width, out);
+            relax_row(previous.data(), m_width, out);
+            std::copy(out, out + m_width, previous.begin() + 1);
+        }
+    });
+
+    // Upwards: the field of the pass down is only read, the result goes back in `rows`
+    pool.parallel_for(0, m_height, band_rows, [&](int row_begin, int row_end) {
+        std::vector<uint8_t> previous(m_width + 2, k_far), current(m_width);
+        for (int y = std::min(row_end + halo, m_height) - 1; y >= row_begin; --y) {
+            uint8_t *out = y < row_end ? row_distance(y) : current.data();
+            std::copy(row(y), row(y) + m_width, out);
+            relax_row(previous.data(), m_width, out);
+            std::copy(out, out + m_width, previous.begin() + 1);
+        }
+    });
+
+    m_distances.swap(rows);
+}
+
+BitMask DistanceField::threshold(int radius) const {
+    const uint64_t limit = static_cast<uint64_t>(std::clamp(radius, 0, k_max_distance));
+    constexpr uint64_t k_ones = 0x0101010101010101ull, k_highs = 0x8080808080808080ull;
+
+    BitMask mask(m_width, m_height);
+    core::ThreadPool::global().parallel_for(
+        0, m_height, rows_per_band(m_width, m_height), [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y) {
+                const uint8_t *distances = row(y);
+                uint64_t *words = mask.row(y);
+                for (int i = 0; i < mask.words_per_row(); ++i) {
+                    const int x0 = i * 64, count = std::min(64, m_width - x0);
+                    uint64_t word = 0;
+                    int bit = 0;
+                    // Eight distances at a time (little endian). They are all below 128, so the
+                    // high bit of (d | 0x80) - (limit + 1) tells whether d > limit without
+                    // borrowing from the next byte. The multiply gathers the eight high bits in
+                    // the top byte.
+                    for (; bit + 8 <= count; bit += 8) {
+                        uint64_t chunk;
+                        std::memcpy(&chunk, distances + x0 + bit, sizeof(chunk));
+                        uint64_t above = ((chunk | k_highs) - (limit + 1) * k_ones) & k_highs;
+                        uint64_t within = (~above & k_highs) >> 7;
+                        word |= ((within * 0x0102040810204080ull) >> 56) << bit;
+                    }
+                    for (; bit < count; ++bit) {
+                        word |= static_cast<uint64_t>(distances[x0 + bit] <= limit) << bit;
+                    }
+                    words[i] = word;
+                }
+            }
+        });
+    return mask;
+}
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cstdlib>
+#include <extraction/frame_hash.hpp>
+
+namespace piksy {
+namespace extraction {
+
+// Cells at least as wide as the search window, so a query never visits more than 2x2 cells
+FrameHash::FrameHash(int tolerance)
+    : m_tolerance(std::max(tolerance, 0)), m_cell_size(std::max(2 * m_tolerance + 1, 16)) {}
+
+uint64_t FrameHash::key(int column, int row) const {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32) |
+           static_cast<uint32_t>(row);
+}
+
+int FrameHash::cell(int coordinate) const {
+    // Round towards negative infinity so frames left of or above the origin get their own cells
+    return coordinate >= 0 ? coordinate / m_cell_size
+                           : -((-coordinate + m_cell_size - 1) / m_cell_size);
+}
+
+void FrameHash::insert(const rendering::Frame &frame) {
+    m_cells[key(cell(frame.x), cell(frame.y))].push_back({frame.x, frame.y, frame.w, frame.h});
+}
+
+void FrameHash::insert(const std::vector<rendering::Frame> &frames) {
+    m_cells.reserve(m_cells.size() + frames.size());
+    for (const auto &frame : frames) insert(frame);
+}
+
+bool FrameHash::contains_similar(const rendering::Frame &frame) const {
+    for (int row = cell(frame.y - m_tolerance); row <= cell(frame.y + m_tolerance); ++row) {
+        for (int column = cell(frame.x - m_tolerance); column <= cell(frame.x + m_tolerance);
+             ++column) {
+            auto it = m_cells.find(key(column, row));
+            if (it == m_cells.end()) continue;
+
+            for (const SDL_Rect &other : it->second) {
+                if (std::abs(frame.x - other.x) <= m_tolerance &&
+                    std::abs(frame.y - other.y) <= m_tolerance &&
+                    std::abs(frame.w - other.w) <= m_tolerance &&
+                    std::abs(frame.h - other.h) <= m_tolerance) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace extraction
+}  // namespace piksy
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <core/thread_pool.hpp>
+#include <cstdint>
+#include <extraction/labeller.hpp>
+#include <limits>
+#include <utils/pixels.hpp>
+
+namespace piksy {
+namespace extraction {
+
+namespace {
+
+// A horizontal span [x0, x1) of identical mask values on one row
+struct Run {
+    int x0, x1;
+    int y;
+};
+
+// Runs of both values of the mask, stored in raster order with the first run of each row
+struct Runs {
+    std::vector<Run> foreground;
+    std::vector<Run> background;
+    std::vector<size_t> foreground_rows;
+    std::vector<size_t> background_rows;
+    // Background run right before each foreground run, or npos when it starts the row
+    std::vector<size_t> left_background;
+};
+
+constexpr size_t k_npos = std::numeric_limits<size_t>::max();
+
+class UnionFind {
+   public:
+    explicit UnionFind(size_t size) : m_parents(size) {
+        for (size_t i = 0; i < size; ++i) m_parents[i] = static_cast<uint32_t>(i);
+    }
+
+    uint32_t find(uint32_t i) {
+        while (m_parents[i] != i) {
+            m_parents[i] = m_parents[m_parents[i]];
+            i = m_parents[i];
+        }
+        return i;
+    }
+
+    // The smallest index stays the root, it is the first run of the component in raster order.
+    // Uniting runs of disjoint index ranges from several threads is safe: parents never leave
+    // the range of their child.
+    void unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a < b) {
+            m_parents[b] = a;
+        } else if (b < a) {
+            m_parents[a] = b;
+        }
+    }
+
+    // Point every entry straight at its root. Parents always have a smaller index than their
+    // children, so a single forward pass is enough.
+    void flatten() {
+        for (size_t i = 0; i < m_parents.size(); ++i) m_parents[i] = m_parents[m_parents[i]];
+    }
+
+    // Root of `i`, only valid after `flatten()`
+    uint32_t root(uint32_t i) const { return m_parents[i]; }
+
+   private:
+    std::vector<uint32_t> m_parents;
+};
+
+bool cancelled(const CancelCheck &is_cancelled) { return is_cancelled && is_cancelled(); }
+
+// Rows are processed in full width bands: a few per thread so they balance, and at least ~64K
+// pixels each so small textures stay on the calling thread
+int rows_per_band(int width, int height) {
+    int num_bands = static_cast<int>(core::ThreadPool::global().size() + 1) * 4;
+    return std::max({1, (1 << 16) / width, (height + num_bands - 1) / num_bands});
+}
+
+void append_row_runs(const BitMask &mask, int y, Runs &runs) {
+    runs.foreground_rows.push_back(runs.foreground.size());
+    runs.background_rows.push_back(runs.background.size());
+
+    int x = 0;
+    while (x < mask.width()) {
+        int begin = x;
+        bool value = mask.get(x, y);
+        x = mask.find_change(x, y, value);
+
+        if (value) {
+            runs.left_background.push_back(begin == 0 ? k_npos : runs.background.size() - 1);
+            runs.foreground.push_back({begin, x, y});
+        } else {
+            runs.background.push_back({begin, x, y});
+        }
+    }
+}
+
+// Runs of the whole mask, bands are built in parallel then stitched in raster order. Empty once
+// cancelled.
+Runs build_runs(const BitMask &mask, int rows_per_band, const CancelCheck &is_cancelled) {
+    const int height = mask.height();
+    const int num_bands = (height + rows_per_band - 1) / rows_per_band;
+
+    std::vector<Runs> bands(num_bands);
+    core::ThreadPool::global().parallel_for(0, num_bands, 1, [&](int band_begin, int band_end) {
+        for (int band = band_begin; band < band_end && !cancelled(is_cancelled); ++band) {
+            int row_end = std::min((band + 1) * rows_per_band, height);
+            for (int y = band * rows_per_band; y < row_end; ++y) {
+                append_row_runs(mask, y, bands[band]);
+            }
+        }
+    });
+    if (cancelled(is_cancelled)) return {};
+
+    std::vector<size_t> foreground_bases(num_bands + 1, 0), background_bases(num_bands + 1, 0);
+    for (int band = 0; band < num_bands; ++band) {
+        foreground_bases[band + 1] = foreground_bases[band] + bands[band].foreground.size();
+        background_bases[band + 1] = background_bases[band] + bands[band].background.size();
+    }
+
+    Runs runs;
+    runs.foreground.resize(foreground_bases[num_bands]);
+    runs.background.resize(background_bases[num_bands]);
+    runs.left_background.resize(foreground_bases[num_bands]);
+    runs.foreground_rows.resize(height + 1);
+    runs.background_rows.resize(height + 1);
+
+    core::ThreadPool::global().parallel_for(0, num_bands, 1, [&](int band_begin, int band_end) {
+        for (int band = band_begin; band < band_end; ++band) {
+            const Runs &local = bands[band];
+            const size_t foreground_base = foreground_bases[band];
+            const size_t background_base = background_bases[band];
+
+            std::copy(local.foreground.begin(), local.foreground.end(),
+                      runs.foreground.begin() + foreground_base);
+            std::copy(local.background.begin(), local.background.end(),
+                      runs.background.begin() + background_base);
+            for (size_t i = 0; i < local.left_background.size(); ++i) {
+                size_t left = local.left_background[i];
+                runs.left_background[foreground_base + i] =
+                    left == k_npos ? k_npos : left + background_base;
+            }
+            for (size_t row = 0; row < local.foreground_rows.size(); ++row) {
+                size_t y = static_cast<size_t>(band) * rows_per_band + row;
+                runs.foreground_rows[y] = local.foreground_rows[row] + foreground_base;
+                runs.background_rows[y] = local.background_rows[row] + background_base;
+            }
+        }
+    });
+
+    runs.foreground_rows[height] = runs.foreground.size();
+    runs.background_rows[height] = runs.background.size();
+    return runs;
+}
+
+// Unite the runs of two consecutive rows that touch. `reach` is 1 for 8-connectivity (diagonal
+// neighbours touch) and 0 for 4-connectivity.
+void unite_rows(const std::vector<Run> &runs, size_t above_begin, size_t above_end,
+                size_t below_begin, size_t below_end, int reach, UnionFind &sets) {
+    size_t above = above_begin, below = below_begin;
+    while (above < above_end && below < below_end) {
+        const Run &a = runs[above];
+        const Run &b = runs[below];
+        if (a.x0 < b.x1 + reach && b.x0 < a.x1 + reach) {
+            sets.unite(static_cast<uint32_t>(above), static_cast<uint32_t>(below));
+        }
+        // Advance the run ending first, the other one may still touch the next run
+        if (a.x1 < b.x1) {
+            ++above;
+        } else {
+            ++below;
+        }
+    }
+}
+
+}  // namespace
+
+BitMask threshold_mask(const rendering::PixelView &pixels, int threshold,
+                       const CancelCheck &is_cancelled) {
+    BitMask mask(pixels.width, pixels.height);
+    if (mask.empty()) return mask;
+
+    core::ThreadPool::global().parallel_for(
+        0, pixels.height, rows_per_band(pixels.width, pixels.height),
+        [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end && !cancelled(is_cancelled); ++y) {
+                utils::pixels::gray_mask_bits_rgba8888(pixels.row(y), pixels.width, threshold,
+                                                       mask.row(y));
+            }
+        });
+    return mask;
+}
+
+std::vector<Component> label_components(const rendering::PixelView &pixels,
+                                        const ExtractionSettings &settings,
+                                        const CancelCheck &is_cancelled) {
+    BitMask mask = threshold_mask(pixels, settings.threshold, is_cancelled);
+    if (cancelled(is_cancelled)) return {};
+    mask.dilate(settings.dilation);
+    return label_mask(mask, is_cancelled);
+}
+
+std::vector<Component> label_mask(const BitMask &mask, const CancelCheck &is_cancelled) {
+    if (mask.empty() || cancelled(is_cancelled)) return {};
+
+    const int width = mask.width(), height = mask.height();
+    const int band_rows = rows_per_band(width, height);
+    const int num_bands = (height + band_rows - 1) / band_rows;
+    Runs runs = build_runs(mask, band_rows, is_cancelled);
+    if (cancelled(is_cancelled)) return {};
+
+    UnionFind foreground(runs.foreground.size());
+    UnionFind background(runs.background.size());
+    auto unite_with_row_above = [&](int y) {
+        unite_rows(runs.foreground, runs.foreground_rows[y - 1], runs.foreground_rows[y],
+                   runs.foreground_rows[y], runs.foreground_rows[y + 1], 1, foreground);
+        unite_rows(runs.background, runs.background_rows[y - 1], runs.background_rows[y],
+                   runs.background_rows[y], runs.background_rows[y + 1], 0, background);
+    };
+
+    // Each band is labelled on its own, then the components crossing the seams between bands
+    // are merged by uniting the two rows around every seam
+    core::ThreadPool::global().parallel_for(0, num_bands, 1, [&](int band_begin, int band_end) {
+        for (int band = band_begin; band < band_end && !cancelled(is_cancelled); ++band) {
+            int row_end = std::min((band + 1) * band_rows, height);
+            for (int y = band * band_rows + 1; y < row_end; ++y) unite_with_row_above(y);
+        }
+    });
+    if (cancelled(is_cancelled)) return {};
+    for (int band = 1; band < num_bands; ++band) unite_with_row_above(band * band_rows);
+
+    foreground.flatten();
+    background.flatten();
+
+    // Background regions reaching the image border surround the outermost components
+    std::vector<uint8_t> outer(runs.background.size(), 0);
+    for (size_t i = 0; i < runs.background.size(); ++i) {
+        const Run &run = runs.background[i];
+        if (run.y == 0 || run.y == height - 1 || run.x0 == 0 || run.x1 == width) {
+            outer[background.root(static_cast<uint32_t>(i))] = 1;
+        }
+    }
+
+    // Roots are the first run of their component, so the first time a root shows up is where a
+    // raster scan discovers the component. The background on the left of that run is the region
+    // directly surrounding the component: if it is not the outer one, the component lies in a
+    // hole and findContours(RETR_EXTERNAL) skips it.
+    struct Stats {
+        int min_x, min_y, max_x, max_y;
+        size_t num_pixels;
+        bool external;
+    };
+    std::vector<Stats> stats(runs.foreground.size());
+    std::vector<uint32_t> roots;
+    for (size_t i = 0; i < runs.foreground.size(); ++i) {
+        const Run &run = runs.foreground[i];
+        uint32_t root = foreground.root(static_cast<uint32_t>(i));
+        if (root == i) {
+            size_t left = runs.left_background[i];
+            bool external = left == k_npos || outer[background.root(static_cast<uint32_t>(left))];
+            stats[root] = {run.x0, run.y, run.x1 - 1, run.y, 0, external};
+            roots.push_back(root);
+        }
+
+        Stats &component = stats[root];
+        component.min_x = std::min(component.min_x, run.x0);
+        component.max_x = std::max(component.max_x, run.x1 - 1);
+        component.max_y = run.y;
+        component.num_pixels += static_cast<size_t>(run.x1 - run.x0);
+    }
+
+    // findContours lists the components from the last discovered to the first
+    std::vector<Component> components;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+        const Stats &component = stats[*it];
+        if (!component.external) continue;
+        components.push_back({component.min_x, component.min_y,
+                              component.max_x - component.min_x + 1,
+                              component.max_y - component.min_y + 1, component.num_pixels});
+    }
+    return components;
+}
+
+}  // namespace extraction
+}  // namespace piksy
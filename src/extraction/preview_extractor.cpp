@@ -0,0 +1,96 @@
+#include <command/frame_extraction_command.hpp>
+#include <core/thread_pool.hpp>
+#include <extraction/preview_extractor.hpp>
+
+namespace piksy {
+namespace extraction {
+
+PreviewExtractor::~PreviewExtractor() {
+    // The running job uses this object, wait for it to notice it is stale
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.reset();
+    ++m_latest;
+    m_idle.wait(lock, [this] { return !m_running; });
+}
+
+void PreviewExtractor::request(const rendering::PixelSnapshot &pixels, const SDL_Rect &rect,
+                               const ExtractionSettings &settings) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_last && m_last->pixels.version == pixels.version &&
+            SDL_RectEquals(&m_last->rect, &rect) && m_last->settings == settings) {
+            return;
+        }
+
+        // Keep the identity of the request but not the pixels, they can be freed once labelled
+        m_last = Request{++m_latest, {nullptr, {}, pixels.version}, rect, settings};
+        m_pending = Request{m_last->id, pixels, rect, settings};
+
+        if (m_running) return;
+        m_running = true;
+    }
+
+    // Submitted outside of the lock, the pool runs it right away when it has no worker
+    core::ThreadPool::global().submit([this] { run(); });
+}
+
+std::shared_ptr<const ExtractionPreview> PreviewExtractor::result() const {
+    return std::atomic_load(&m_result);
+}
+
+bool PreviewExtractor::is_up_to_date() const {
+    auto preview = result();
+    return preview != nullptr && !is_stale(preview->request);
+}
+
+void PreviewExtractor::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.reset();
+    m_last.reset();
+    ++m_latest;
+    std::atomic_store(&m_result, std::shared_ptr<const ExtractionPreview>());
+}
+
+void PreviewExtractor::run() {
+    while (true) {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_pending) {
+                m_running = false;
+                m_idle.notify_all();
+                return;
+            }
+            request = std::move(*m_pending);
+            m_pending.reset();
+        }
+
+        // Labelling is the slow part, it only runs when the pixels or the settings changed and
+        // stops between two row blocks as soon as a newer request comes
+        if (is_stale(request.id)) continue;
+        if (!m_index.update(request.pixels, request.settings,
+                            [this, id = request.id] { return is_stale(id); })) {
+            continue;
+        }
+        if (is_stale(request.id)) continue;
+
+        auto preview = std::make_shared<ExtractionPreview>();
+        preview->request = request.id;
+        preview->version = request.pixels.version;
+        preview->rect = request.rect;
+        preview->num_components = m_index.size();
+        m_index.query(request.rect, preview->frames);
+        commands::FrameExtractionCommand::sort_frames(preview->frames);
+
+        // Checked under the lock so a cancel() cannot slip in before the store
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!is_stale(request.id)) {
+            std::atomic_store(&m_result,
+                              std::shared_ptr<const ExtractionPreview>(std::move(preview)));
+            core::ThreadPool::global().wake_main_thread();
+        }
+    }
+}
+
+}  // namespace extraction
+}  // namespace piksy
@@ -13,15 +13,20 @@ namespace layers {
 
 EditorLayer::EditorLayer(rendering::Renderer& renderer, core::State& state,
                          managers::ResourceManager& resource_manager,
-                         managers::AnimationManager& animation_manager)
+                         managers::AnimationManager& animation_manager,
+                         commands::CommandExecutor& command_executor,
+                         commands::History& history)
     : Layer(state, "EditorLayer"),
       m_renderer(renderer),
       m_resource_manager(resource_manager),
-      m_animation_manager(animation_manager) {}
+      m_animation_manager(animation_manager),
+      m_command_executor(command_executor),
+      m_history(history) {}
 
 void EditorLayer::on_attach() {
-    m_viewport = std::make_unique<components::Viewport>(m_state, m_renderer, m_resource_manager,
-                                                        m_animation_manager);
+    m_viewport = std::make_unique<components::Viewport>(
+        m_state, m_renderer, m_resource_manager, m_animation_manager, m_command_executor,
+        m_history);
     m_console = std::make_unique<components::Console>(m_state);
     m_animation_player = std::make_unique<components::AnimationPlayer>(m_state);
     m_project = std::make_unique<components::Project>(m_state, m_resource_manager);
@@ -79,10 +79,46 @@ bool AnimationManager::update_animation_name(const std::string& name) {
     return true;
 }
 
+rendering::Animation* AnimationManager::animation(const std::string& name) {
+    auto it = m_animations.find(name);
+    return it != m_animations.end() ? &it->second : nullptr;
+}
+
+std::string AnimationManager::current_animation_name() const {
+    for (const auto& [name, animation] : m_animations) {
+        if (&animation == m_current_animation) return name;
+    }
+    return {};
+}
+
 void AnimationManager::clear() {
     m_animations.clear();
     m_current_animation = nullptr;
-    core::Logger::info("Cleared all the animations. (TODO: Make it undo-able)");
+    core::Logger::info("Cleared all the animations.");
+}
+
+AnimationManager::Snapshot AnimationManager::snapshot() const {
+    Snapshot snapshot;
+    snapshot.animations.reserve(m_animations.size());
+    for (const auto& [name, animation] : m_animations) {
+        snapshot.animations.emplace_back(name, animation.frames);
+    }
+    snapshot.current_animation = current_animation_name();
+    return snapshot;
+}
+
+void AnimationManager::restore(const Snapshot& snapshot) {
+    m_animations.clear();
+    m_current_animation = nullptr;
+
+    for (const auto& [name, frames] : snapshot.animations) {
+        auto [it, inserted] = m_animations.emplace(name, rendering::Animation(name));
+        // The name is a view, point it at the key rather than at the snapshot
+        it->second.name = it->first;
+        it->second.frames = frames;
+    }
+
+    if (!snapshot.current_animation.empty()) set_current_animation(snapshot.current_animation);
 }
 
 }  // namespace managers
@@ -1,18 +1,91 @@
+#include <core/future.hpp>
 #include <core/logger.hpp>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <managers/resource_manager.hpp>
+#include <optional>
 #include <stdexcept>
+#include <utils/hash.hpp>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace piksy {
 namespace managers {
 
+namespace {
+
+std::vector<uint8_t> read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        core::Logger::error("Failed to open the file: %s", path.c_str());
+        throw std::runtime_error("Failed to open the file: " + path);
+    }
+
+    std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+        core::Logger::error("Failed to read the file: %s", path.c_str());
+        throw std::runtime_error("Failed to read the file: " + path);
+    }
+    return bytes;
+}
+
+struct FileContent {
+    uint64_t hash = 0;
+    // Null when the pixel cache has the decoded pixels
+    std::shared_ptr<const std::vector<uint8_t>> bytes;
+};
+
+struct ReloadedImage {
+    uint64_t hash = 0;
+    rendering::Image image;  // Empty when the content did not change
+};
+
+// Runs on a worker. A valid entry in the pixel cache already knows the hash, the file is not
+// even read then.
+FileContent read_content(const rendering::PixelCache *cache, const std::string &path) {
+    FileContent content;
+    if (cache != nullptr) {
+        if (std::optional<uint64_t> hash = cache->find(path)) {
+            content.hash = *hash;
+            return content;
+        }
+    }
+
+    content.bytes = std::make_shared<const std::vector<uint8_t>>(read_file(path));
+    content.hash = utils::hash::xxhash64(content.bytes->data(), content.bytes->size());
+    return content;
+}
+
+// Runs on a worker. `bytes` is the content of the file, null when the cache has it.
+// The decoded pixels are only stored in the cache once the texture has them.
+rendering::Image decode_texture(const rendering::PixelCache *cache,
+                                const std::vector<uint8_t> *bytes, const std::string &path,
+                                uint64_t hash) {
+    if (bytes == nullptr) {
+        try {
+            return cache->map(path, hash);
+        } catch (const std::exception &ex) {
+            // Removed or replaced since it was checked, decode the file after all
+            core::Logger::warn("Failed to use the cached pixels: %s", ex.what());
+            return rendering::Texture2D::decode(path);
+        }
+    }
+
+    return rendering::Texture2D::decode(bytes->data(), bytes->size());
+}
+
+}  // namespace
+
 void ResourceManager::cleanup() {
     for (auto it = m_textures.begin(); it != m_textures.end(); ++it) {
         core::Logger::debug("Cleaning up texture: %s", it->first.c_str());
+        m_file_watcher.unwatch(it->first);
     }
     m_textures.clear();
+    m_texture_lru.clear();
 
     for (auto it = m_fonts.begin(); it != m_fonts.end(); ++it) {
         core::Logger::debug("Cleaning up font: %s", it->first.c_str());
@@ -26,21 +99,258 @@ void ResourceManager::load_texture(const std::string &texture_path) { get_textur
 
 std::shared_ptr<rendering::Texture2D> ResourceManager::get_texture(
     const std::string &texture_path) {
-    auto texture_found = m_textures.find(texture_path);
-    if (texture_found != m_textures.end()) {
-        return texture_found->second;
-    }
-
-    if (!fs::exists(texture_path)) {
+    std::error_code error;
+    const std::string path = fs::canonical(texture_path, error).string();
+    if (error) {
         core::Logger::error("Failed to get the texture: File not found, Path: %s",
                             texture_path.c_str());
         throw std::runtime_error("Failed to get the texture: File not found at: " + texture_path);
     }
 
-    core::Logger::debug("Loading texture: %s", texture_path.c_str());
-    m_textures.emplace(texture_path,
-                       std::make_shared<rendering::Texture2D>(m_renderer.get(), texture_path));
-    return m_textures.at(texture_path);
+    auto found = m_textures.find(path);
+    if (found != m_textures.end()) {
+        m_texture_lru.splice(m_texture_lru.begin(), m_texture_lru, found->second.lru);
+        return found->second.texture;
+    }
+
+    core::Logger::debug("Loading texture: %s", path.c_str());
+    auto texture = std::make_shared<rendering::Texture2D>(path);
+    m_texture_lru.push_front(path);
+    m_textures.emplace(path, TextureEntry{texture, m_texture_lru.begin()});
+    m_file_watcher.watch(path);
+    ++m_num_pending_textures;
+
+    // The placeholder is only held weakly, nobody may want the texture anymore once decoded.
+    // Even reading the file happens on a worker, a large sheet takes a while to read.
+    std::weak_ptr<rendering::Texture2D> placeholder = texture;
+    core::async([cache = m_pixel_cache, path] { return read_content(cache.get(), path); })
+        .then_on_main([this, placeholder, path](core::Future<FileContent> content) {
+            try {
+                FileContent read = content.get();
+                load_content(path, placeholder, read.hash, std::move(read.bytes));
+            } catch (const std::exception &ex) {
+                --m_num_pending_textures;
+                fail_loading(path, placeholder.lock(), ex);
+            }
+        });
+
+    return texture;
+}
+
+void ResourceManager::load_content(const std::string &path,
+                                   const std::weak_ptr<rendering::Texture2D> &target,
+                                   uint64_t hash,
+                                   std::shared_ptr<const std::vector<uint8_t>> bytes) {
+    std::shared_ptr<rendering::Texture2D> texture = target.lock();
+    if (texture == nullptr) {
+        --m_num_pending_textures;
+        return;
+    }
+
+    auto entry = m_textures.find(path);
+    if (entry != m_textures.end() && entry->second.texture == texture) entry->second.hash = hash;
+
+    // Same content as a texture already loaded: the pixels are shared until either is edited,
+    // each texture keeps its own path
+    if (std::shared_ptr<rendering::Texture2D> twin = find_content(hash)) {
+        --m_num_pending_textures;
+        core::Logger::debug("Texture %s has the same content as %s, sharing its pixels",
+                            path.c_str(), twin->path().c_str());
+        texture->set_image(m_renderer.get(), twin->image());
+        twin.reset();
+        texture.reset();
+        evict_textures();
+        return;
+    }
+    texture.reset();
+
+    core::async([cache = m_pixel_cache, bytes, path, hash] {
+        return decode_texture(cache.get(), bytes.get(), path, hash);
+    })
+        .then_on_main([this, target, path, hash,
+                       decoded = bytes != nullptr](core::Future<rendering::Image> image) {
+            --m_num_pending_textures;
+            std::shared_ptr<rendering::Texture2D> texture = target.lock();
+            try {
+                rendering::Image loaded = image.get();
+                if (texture == nullptr) return;
+
+                texture->set_image(m_renderer.get(), std::move(loaded));
+                if (decoded) store_pixels(path, hash, texture->image());
+                core::Logger::debug("Loaded texture: %s (%dx%d)", path.c_str(), texture->width(),
+                                    texture->height());
+            } catch (const std::exception &ex) {
+                fail_loading(path, texture, ex);
+            }
+
+            texture.reset();
+            evict_textures();
+        });
+}
+
+std::shared_ptr<rendering::Texture2D> ResourceManager::find_content(uint64_t hash) const {
+    for (const auto &[path, entry] : m_textures) {
+        if (entry.hash == hash && entry.texture->is_loaded() && !entry.texture->is_modified()) {
+            return entry.texture;
+        }
+    }
+    return nullptr;
+}
+
+void ResourceManager::fail_loading(const std::string &path,
+                                   const std::shared_ptr<rendering::Texture2D> &texture,
+                                   const std::exception &error) {
+    core::Logger::error("Failed to load the texture %s: %s", path.c_str(), error.what());
+    // Forget the placeholder, the next get_texture() tries again
+    auto it = m_textures.find(path);
+    if (it != m_textures.end() && it->second.texture == texture) erase_texture(it);
+}
+
+void ResourceManager::update() {
+    // Undoing every edit of a texture makes it unmodified again, the file wins from then on
+    for (auto it = m_deferred_reloads.begin(); it != m_deferred_reloads.end();) {
+        auto entry = m_textures.find(*it);
+        if (entry != m_textures.end() && entry->second.texture->is_modified()) {
+            ++it;
+            continue;
+        }
+        std::string path = *it;
+        it = m_deferred_reloads.erase(it);
+        reload_texture(path);
+    }
+    for (const std::string &path : m_file_watcher.poll_changes()) reload_texture(path);
+}
+
+void ResourceManager::defer_reload(const std::string &path) {
+    if (m_deferred_reloads.insert(path).second) {
+        core::Logger::warn("%s changed on disk but has unsaved edits, it is reloaded once they "
+                           "are undone",
+                           path.c_str());
+    }
+}
+
+void ResourceManager::reload_texture(const std::string &path) {
+    auto entry = m_textures.find(path);
+    if (entry == m_textures.end()) return;
+    if (entry->second.texture->is_modified()) {
+        defer_reload(path);
+        return;
+    }
+    const uint64_t hash = entry->second.hash;
+
+    core::Logger::debug("Texture changed on disk: %s", path.c_str());
+    ++m_num_pending_textures;
+
+    std::weak_ptr<rendering::Texture2D> target = entry->second.texture;
+    core::async([cache = m_pixel_cache, path, hash] {
+        std::vector<uint8_t> bytes = read_file(path);
+        ReloadedImage reloaded;
+        reloaded.hash = utils::hash::xxhash64(bytes.data(), bytes.size());
+        // Saved again without changes, nothing to decode
+        if (reloaded.hash == hash) return reloaded;
+
+        reloaded.image = decode_texture(cache.get(), &bytes, path, reloaded.hash);
+        return reloaded;
+    })
+        .then_on_main([this, target, path](core::Future<ReloadedImage> result) {
+            --m_num_pending_textures;
+            std::shared_ptr<rendering::Texture2D> texture = target.lock();
+            try {
+                ReloadedImage reloaded = result.get();
+                if (texture == nullptr || reloaded.image.pixels == nullptr) return;
+
+                if (texture->is_modified()) {
+                    // Edited while the new pixels were decoded
+                    defer_reload(path);
+                } else {
+                    texture->set_image(m_renderer.get(), std::move(reloaded.image));
+                    store_pixels(path, reloaded.hash, texture->image());
+                    if (m_on_texture_reloaded) m_on_texture_reloaded(texture.get());
+                    auto entry = m_textures.find(path);
+                    if (entry != m_textures.end() && entry->second.texture == texture) {
+                        entry->second.hash = reloaded.hash;
+                    }
+                    core::Logger::info("Reloaded texture: %s (%dx%d)", path.c_str(),
+                                       texture->width(), texture->height());
+                }
+            } catch (const std::exception &ex) {
+                core::Logger::error("Failed to reload the texture %s: %s", path.c_str(),
+                                    ex.what());
+            }
+
+            texture.reset();
+            evict_textures();
+        });
+}
+
+void ResourceManager::set_pixel_cache(const std::string &directory, size_t budget) {
+    m_pixel_cache = directory.empty()
+                        ? nullptr
+                        : std::make_shared<const rendering::PixelCache>(directory, budget);
+}
+
+void ResourceManager::store_pixels(const std::string &path, uint64_t hash,
+                                   const rendering::Image &image) {
+    if (m_pixel_cache == nullptr) return;
+
+    // The buffer is shared with the texture, the first edit copies it instead of writing to it
+    core::ThreadPool::global().submit(
+        [cache = m_pixel_cache, path, hash, image] { cache->store(path, hash, image); });
+}
+
+void ResourceManager::set_texture_budget(size_t num_bytes) {
+    m_texture_budget = num_bytes;
+    evict_textures();
+}
+
+size_t ResourceManager::num_texture_bytes() const {
+    // Pixels shared by copies of a file are counted for each copy, the budget errs on the safe
+    // side
+    size_t num_bytes = 0;
+    for (const auto &[path, entry] : m_textures) num_bytes += entry.texture->num_bytes();
+    return num_bytes;
+}
+
+std::vector<ResourceManager::TextureInfo> ResourceManager::texture_infos() const {
+    std::vector<TextureInfo> infos;
+    infos.reserve(m_texture_lru.size());
+    for (const std::string &path : m_texture_lru) {
+        const TextureEntry &entry = m_textures.at(path);
+        infos.push_back({path, entry.texture->num_bytes(), is_in_use(entry)});
+    }
+    return infos;
+}
+
+bool ResourceManager::is_in_use(const TextureEntry &entry) {
+    // Held by a sprite, a command or the history, or holding edits that would be lost
+    return entry.texture.use_count() > 1 || entry.texture->is_modified();
+}
+
+void ResourceManager::evict_textures() {
+    size_t num_bytes = num_texture_bytes();
+    // Walk from the least recently used, `next` is the entry after the candidate so it stays
+    // valid when the candidate is erased
+    auto next = m_texture_lru.end();
+    while (num_bytes > m_texture_budget && next != m_texture_lru.begin()) {
+        auto it = m_textures.find(*std::prev(next));
+        if (is_in_use(it->second) || !it->second.texture->is_loaded()) {
+            --next;
+            continue;
+        }
+
+        const size_t texture_bytes = it->second.texture->num_bytes();
+        core::Logger::debug("Evicting texture: %s (%.1f MB)", it->second.texture->path().c_str(),
+                            texture_bytes / (1024.0f * 1024.0f));
+        num_bytes -= texture_bytes;
+        erase_texture(it);
+    }
+}
+
+void ResourceManager::erase_texture(std::unordered_map<std::string, TextureEntry>::iterator it) {
+    // Nothing to reload anymore, the next get_texture() reads the file again anyway
+    m_file_watcher.unwatch(it->first);
+    m_texture_lru.erase(it->second.lru);
+    m_textures.erase(it);
 }
 
 void ResourceManager::load_font(const std::string &font_path) { get_font(font_path); }
@@ -0,0 +1,69 @@
+#include <core/logger.hpp>
+#include <exception>
+#include <rendering/color_swap_preview.hpp>
+#include <utils/pixels.hpp>
+
+namespace piksy {
+namespace rendering {
+
+// Semi transparent magenta, stands out on most sprite sheets
+static constexpr uint32_t k_highlight_color = 0xFF00FFB4;
+
+void ColorSwapPreview::pick(std::shared_ptr<Texture2D> texture, const SDL_Color& color) {
+    clear();
+    if (texture == nullptr) return;
+
+    PixelView pixels = texture->pixels();
+    if (pixels.empty()) {
+        core::Logger::warn("Color swap preview needs the CPU pixels of the texture");
+        return;
+    }
+
+    m_distances.resize(static_cast<size_t>(pixels.width) * pixels.height);
+    utils::pixels::color_distance_rgba8888(
+        pixels.pixels, pixels.width, pixels.height, pixels.pitch,
+        utils::pixels::pack_rgba8888(color.r, color.g, color.b, color.a), m_distances.data());
+
+    m_texture = std::move(texture);
+    m_color = color;
+}
+
+void ColorSwapPreview::clear() {
+    m_texture = nullptr;
+    m_distances.clear();
+    m_distances.shrink_to_fit();
+    m_overlay.clear();
+    m_overlay_pixels.clear();
+    m_overlay_pixels.shrink_to_fit();
+    m_overlay_threshold = -1;
+    m_num_affected = 0;
+}
+
+void ColorSwapPreview::update(SDL_Renderer* renderer, uint8_t threshold) {
+    if (!is_active() || threshold == m_overlay_threshold) return;
+
+    const int width = m_texture->width();
+    const int height = m_texture->height();
+
+    if (m_overlay.empty()) {
+        // Tiled like the texture, a sheet larger than the renderer limit fits no single texture
+        try {
+            m_overlay = create_tiles(renderer, width, height);
+        } catch (const std::exception& ex) {
+            core::Logger::error("Failed to create the color swap overlay: %s", ex.what());
+            clear();
+            return;
+        }
+        m_overlay_pixels.resize(static_cast<size_t>(width) * height);
+    }
+
+    const int pitch = width * static_cast<int>(sizeof(uint32_t));
+    m_num_affected = utils::pixels::threshold_overlay_rgba8888(m_distances.data(), width, height,
+                                                               threshold, k_highlight_color,
+                                                               m_overlay_pixels.data(), pitch);
+    upload_tiles(m_overlay, m_overlay_pixels.data(), pitch, {0, 0, width, height});
+    m_overlay_threshold = threshold;
+}
+
+}  // namespace rendering
+}  // namespace piksy
@@ -0,0 +1,224 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <core/logger.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <rendering/pixel_cache.hpp>
+#include <stdexcept>
+#include <system_error>
+#include <utils/hash.hpp>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace piksy {
+namespace rendering {
+
+namespace {
+
+constexpr char k_magic[8] = {'P', 'K', 'P', 'I', 'X', 'E', 'L', '1'};
+
+// 64 bytes, so the pixels that follow it in the mapping keep the alignment of Texture2D
+struct Header {
+    char magic[8];
+    int64_t mtime;
+    uint64_t file_size;
+    uint64_t hash;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;
+    uint8_t padding[20];
+};
+static_assert(sizeof(Header) == 64, "The pixels must start 64 bytes into an entry");
+
+struct ImageStat {
+    int64_t mtime = 0;
+    uint64_t file_size = 0;
+};
+
+std::optional<ImageStat> stat_image(const std::string &path) {
+    std::error_code error;
+    auto mtime = fs::last_write_time(path, error);
+    if (error) return std::nullopt;
+    auto file_size = fs::file_size(path, error);
+    if (error) return std::nullopt;
+
+    return ImageStat{static_cast<int64_t>(mtime.time_since_epoch().count()), file_size};
+}
+
+std::optional<Header> read_header(const std::string &entry_path) {
+    std::ifstream file(entry_path, std::ios::binary);
+    Header header;
+    if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return std::nullopt;
+    }
+    if (std::memcmp(header.magic, k_magic, sizeof(k_magic)) != 0) return std::nullopt;
+    if (header.width <= 0 || header.height <= 0 ||
+        header.pitch < header.width * static_cast<int32_t>(sizeof(uint32_t))) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+// The entry describes the image as it is now on disk
+bool is_valid(const Header &header, const std::string &path) {
+    std::optional<ImageStat> stat = stat_image(path);
+    return stat.has_value() && header.mtime == stat->mtime && header.file_size == stat->file_size;
+}
+
+}  // namespace
+
+PixelCache::PixelCache(std::string directory, size_t budget)
+    : m_directory(std::move(directory)), m_budget(budget) {}
+
+std::string PixelCache::entry_path(const std::string &path) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016" PRIx64 ".rgba",
+                  utils::hash::xxhash64(path.data(), path.size()));
+    return (fs::path(m_directory) / name).string();
+}
+
+std::optional<uint64_t> PixelCache::find(const std::string &path) const {
+    std::optional<Header> header = read_header(entry_path(path));
+    if (!header.has_value() || !is_valid(*header, path)) return std::nullopt;
+    return header->hash;
+}
+
+Image PixelCache::map(const std::string &path, uint64_t hash) const {
+    const std::string entry = entry_path(path);
+    std::optional<Header> header = read_header(entry);
+    if (!header.has_value() || header->hash != hash || !is_valid(*header, path)) {
+        throw std::runtime_error("No valid cached pixels for " + path);
+    }
+
+    const size_t num_bytes =
+        sizeof(Header) + static_cast<size_t>(header->pitch) * static_cast<size_t>(header->height);
+    int fd = ::open(entry.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open the cached pixels of " + path);
+
+    // Private mapping: edits to the pixels copy the pages they touch, the file never changes
+    void *mapping = ::mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    const bool truncated = ::lseek(fd, 0, SEEK_END) < static_cast<off_t>(num_bytes);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the cached pixels of " + path);
+    }
+    if (truncated) {
+        ::munmap(mapping, num_bytes);
+        throw std::runtime_error("The cached pixels of " + path + " are truncated");
+    }
+    // The whole image is uploaded right after, start reading it now
+    ::madvise(mapping, num_bytes, MADV_WILLNEED);
+    // The modification time of an entry is its last use, trim() removes the oldest first
+    std::error_code error;
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+
+    Image image;
+    image.width = header->width;
+    image.height = header->height;
+    image.pitch = header->pitch;
+    image.pixels = std::shared_ptr<uint32_t>(
+        reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(mapping) + sizeof(Header)),
+        [mapping, num_bytes](uint32_t *) { ::munmap(mapping, num_bytes); });
+    return image;
+}
+
+void PixelCache::store(const std::string &path, uint64_t hash, const Image &image) const {
+    std::optional<ImageStat> stat = stat_image(path);
+    if (!stat.has_value() || image.pixels == nullptr) return;
+    const size_t num_bytes =
+        sizeof(Header) + static_cast<size_t>(image.pitch) * static_cast<size_t>(image.height);
+    if (num_bytes > m_budget) return;
+
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+    if (error) {
+        core::Logger::warn("Failed to create the pixel cache directory %s: %s",
+                           m_directory.c_str(), error.message().c_str());
+        return;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, k_magic, sizeof(k_magic));
+    header.mtime = stat->mtime;
+    header.file_size = stat->file_size;
+    header.hash = hash;
+    header.width = image.width;
+    header.height = image.height;
+    header.pitch = image.pitch;
+
+    // Written next to the entry then renamed over it, a reader never sees half an entry. The
+    // temporary name is unique across threads and processes sharing the directory.
+    const std::string entry = entry_path(path);
+    std::string tmp_path = entry + ".tmpXXXXXX";
+    int fd = ::mkstemp(tmp_path.data());
+    if (fd < 0) {
+        core::Logger::warn("Failed to create a temporary cache entry for %s: %s", path.c_str(),
+                           std::strerror(errno));
+        return;
+    }
+    ::close(fd);
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(image.pixels.get()),
+                   static_cast<std::streamsize>(image.pitch) * image.height);
+        if (!file) {
+            core::Logger::warn("Failed to write the cached pixels of %s", path.c_str());
+            file.close();
+            fs::remove(tmp_path, error);
+            return;
+        }
+    }
+
+    fs::rename(tmp_path, entry, error);
+    if (error) {
+        core::Logger::warn("Failed to store the cached pixels of %s: %s", path.c_str(),
+                           error.message().c_str());
+        fs::remove(tmp_path, error);
+        return;
+    }
+    core::Logger::debug("Cached the pixels of %s", path.c_str());
+    trim();
+}
+
+void PixelCache::trim() const {
+    struct Entry {
+        fs::file_time_type last_use;
+        uintmax_t num_bytes;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total_bytes = 0;
+
+    std::error_code error;
+    for (fs::directory_iterator it(m_directory, error), end; !error && it != end;
+         it.increment(error)) {
+        if (it->path().extension() != ".rgba") continue;
+        std::error_code stat_error;
+        Entry entry{it->last_write_time(stat_error), it->file_size(stat_error), it->path()};
+        if (stat_error) continue;
+        total_bytes += entry.num_bytes;
+        entries.push_back(std::move(entry));
+    }
+    if (total_bytes <= m_budget) return;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.last_use < b.last_use; });
+    // A removed entry stays readable by the textures that still map it
+    for (const Entry &entry : entries) {
+        if (total_bytes <= m_budget) break;
+        if (fs::remove(entry.path, error)) total_bytes -= entry.num_bytes;
+    }
+    core::Logger::debug("Trimmed the pixel cache to %ju bytes", total_bytes);
+}
+
+}  // namespace rendering
+}  // namespace piksy
@@ -46,11 +46,26 @@ void Sprite::set_texture(std::shared_ptr<Texture2D> texture) {
 
     if (texture == nullptr) return;
 
-    m_frame_rect.w = texture->width();
-    m_frame_rect.h = texture->height();
+    fit_texture();
+}
+
+void Sprite::update() {
+    if (m_texture == nullptr || !m_texture->is_loaded()) return;
+
+    if (m_texture->width() != m_fitted_width || m_texture->height() != m_fitted_height) {
+        fit_texture();
+    }
+}
+
+void Sprite::fit_texture() {
+    m_fitted_width = m_texture->width();
+    m_fitted_height = m_texture->height();
+
+    m_frame_rect.w = m_texture->width();
+    m_frame_rect.h = m_texture->height();
 
-    m_rect.w = texture->width();
-    m_rect.h = texture->height();
+    m_rect.w = m_texture->width();
+    m_rect.h = m_texture->height();
 }
 
 std::shared_ptr<Texture2D> Sprite::texture() const { return m_texture; }
@@ -81,17 +96,32 @@ void Sprite::render(SDL_Renderer *renderer, float scale, float offset_x, int off
     if (m_texture == nullptr) {
         throw std::runtime_error("Cannot render a sprite if the texture is null.");
     }
+    if (!m_texture->is_loaded()) return;
 
-    SDL_Rect scaled_rect = {static_cast<int>((m_rect.x + offset_x) * scale),
-                            static_cast<int>((m_rect.y + offset_y) * scale),
-                            static_cast<int>(m_rect.w * scale), static_cast<int>(m_rect.h * scale)};
+    // Edits made since the last frame are uploaded right before drawing
+    m_texture->flush();
 
-    SDL_RenderCopy(renderer, m_texture->get(), &m_frame_rect, &scaled_rect);
+    SDL_Rect scaled_rect = screen_rect(scale, offset_x, offset_y);
+
+    m_texture->draw(renderer, m_frame_rect, scaled_rect);
 
     if (m_selected) {
         SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
         SDL_RenderDrawRect(renderer, &scaled_rect);
     }
 }
+
+void Sprite::render_overlay(SDL_Renderer *renderer, const std::vector<TextureTile> &overlay,
+                            float scale, float offset_x, int offset_y) const {
+    if (renderer == nullptr || overlay.empty()) return;
+
+    draw_tiles(renderer, overlay, m_frame_rect, screen_rect(scale, offset_x, offset_y));
+}
+
+SDL_Rect Sprite::screen_rect(float scale, float offset_x, int offset_y) const {
+    return {static_cast<int>((m_rect.x + offset_x) * scale),
+            static_cast<int>((m_rect.y + offset_y) * scale), static_cast<int>(m_rect.w * scale),
+            static_cast<int>(m_rect.h * scale)};
+}
 }  // namespace rendering
 }  // namespace piksy
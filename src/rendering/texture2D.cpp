@@ -2,10 +2,17 @@
 #include <SDL_image.h>
 #include <SDL_render.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <core/future.hpp>
 #include <core/logger.hpp>
+#include <cstring>
 #include <filesystem>
+#include <new>
 #include <rendering/texture2D.hpp>
 #include <stdexcept>
+#include <utils/pixels.hpp>
 
 namespace fs = std::filesystem;
 
@@ -13,10 +20,13 @@ namespace piksy {
 namespace rendering {
 
 Texture2D::Texture2D(SDL_Texture* texture) {
-    if (texture != nullptr) {
-        SDL_QueryTexture(texture, nullptr, nullptr, &m_width, &m_height);
-    }
-    m_texture.reset(texture);
+    if (texture == nullptr) return;
+
+    SDL_QueryTexture(texture, nullptr, nullptr, &m_width, &m_height);
+    TextureTile tile;
+    tile.rect = {0, 0, m_width, m_height};
+    tile.texture.reset(texture);
+    m_tiles.push_back(std::move(tile));
 }
 
 Texture2D::Texture2D(SDL_Renderer* renderer, const std::string& texture_path)
@@ -24,6 +34,8 @@ Texture2D::Texture2D(SDL_Renderer* renderer, const std::string& texture_path)
     load(renderer);
 }
 
+Texture2D::Texture2D(const std::string& texture_path) : m_path(texture_path) {}
+
 void Texture2D::reload(SDL_Renderer* renderer) { load(renderer); }
 
 void Texture2D::load(SDL_Renderer* renderer) {
@@ -32,58 +44,426 @@ void Texture2D::load(SDL_Renderer* renderer) {
         throw std::runtime_error("Failed to load the texture, the renderer is null");
     }
 
-    if (!fs::exists(m_path)) {
+    set_image(renderer, decode(m_path));
+}
+
+namespace {
+
+std::atomic<uint64_t> s_next_version{1};
+
+constexpr size_t k_pixels_alignment = 64;
+
+std::shared_ptr<uint32_t> allocate_aligned(size_t num_bytes) {
+    return std::shared_ptr<uint32_t>(
+        static_cast<uint32_t*>(::operator new(num_bytes, std::align_val_t(k_pixels_alignment))),
+        [](uint32_t* pixels) { ::operator delete(pixels, std::align_val_t(k_pixels_alignment)); });
+}
+
+// Use the pixels of an RGBA8888 surface as they are, the surface is freed with its last user
+Image adopt_surface(SDL_Surface* surface) {
+    Image image;
+    image.width = surface->w;
+    image.height = surface->h;
+    image.pitch = surface->pitch;
+    image.pixels = std::shared_ptr<uint32_t>(static_cast<uint32_t*>(surface->pixels),
+                                             [surface](uint32_t*) { SDL_FreeSurface(surface); });
+    return image;
+}
+
+// Takes ownership of the surface. The pixels are never copied besides the one conversion a
+// format other than RGBA8888 needs, and that conversion writes straight into the final buffer
+// when SDL can do it without an intermediate surface.
+Image to_image(SDL_Surface* surface) {
+    const Uint32 format = surface->format->format;
+    if (format == SDL_PIXELFORMAT_RGBA8888 && !SDL_MUSTLOCK(surface)) {
+        return adopt_surface(surface);
+    }
+
+    if (!SDL_ISPIXELFORMAT_INDEXED(format) && !SDL_HasColorKey(surface) && !SDL_MUSTLOCK(surface)) {
+        Image image;
+        image.width = surface->w;
+        image.height = surface->h;
+        image.pitch = image.width * static_cast<int>(sizeof(uint32_t));
+        image.pixels = allocate_aligned(static_cast<size_t>(image.pitch) * image.height);
+
+        const int result =
+            SDL_ConvertPixels(surface->w, surface->h, format, surface->pixels, surface->pitch,
+                              SDL_PIXELFORMAT_RGBA8888, image.pixels.get(), image.pitch);
+        SDL_FreeSurface(surface);
+        if (result != 0) {
+            core::Logger::error("Failed to convert the pixels to RGBA8888 format: %s",
+                                SDL_GetError());
+            throw std::runtime_error(
+                std::string("Failed to convert the pixels to RGBA8888 format: ") + SDL_GetError());
+        }
+        return image;
+    }
+
+    // Palettes and color keys need a whole surface conversion, the converted surface is kept
+    SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
+    SDL_FreeSurface(surface);
+    if (converted_surface == nullptr) {
+        core::Logger::error("Failed to convert surface to RGBA8888 format: %s", SDL_GetError());
+        throw std::runtime_error(std::string("Failed to convert surface to RGBA8888 format: ") +
+                                 SDL_GetError());
+    }
+    return adopt_surface(converted_surface);
+}
+
+// Runs on a worker, each level is half the size of the previous one
+std::vector<Image> downsample_levels(const PixelView& pixels, int max_levels) {
+    std::vector<Image> levels;
+    PixelView source = pixels;
+    while (static_cast<int>(levels.size()) < max_levels &&
+           (source.width > 1 || source.height > 1)) {
+        Image level;
+        level.width = (source.width + 1) / 2;
+        level.height = (source.height + 1) / 2;
+        level.pitch = level.width * static_cast<int>(sizeof(uint32_t));
+        level.pixels = allocate_aligned(static_cast<size_t>(level.pitch) * level.height);
+        utils::pixels::downsample_box_2x_rgba8888(source.pixels, source.width, source.height,
+                                                  source.pitch, level.pixels.get(), level.pitch);
+
+        source = {level.pixels.get(), level.width, level.height, level.pitch};
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+}  // namespace
+
+std::vector<TextureTile> create_tiles(SDL_Renderer* renderer, int width, int height) {
+    // A renderer without a limit reports 0
+    int tile_width = width, tile_height = height;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        if (info.max_texture_width > 0) tile_width = std::min(tile_width, info.max_texture_width);
+        if (info.max_texture_height > 0) {
+            tile_height = std::min(tile_height, info.max_texture_height);
+        }
+    }
+
+    std::vector<TextureTile> tiles;
+    for (int y = 0; y < height; y += tile_height) {
+        for (int x = 0; x < width; x += tile_width) {
+            TextureTile tile;
+            tile.rect = {x, y, std::min(tile_width, width - x), std::min(tile_height, height - y)};
+            tile.texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                                 SDL_TEXTUREACCESS_STREAMING, tile.rect.w,
+                                                 tile.rect.h));
+            if (tile.texture == nullptr) {
+                core::Logger::error("Failed to create a texture: %s", SDL_GetError());
+                throw std::runtime_error(std::string("Failed to create a texture: ") +
+                                         SDL_GetError());
+            }
+            SDL_SetTextureBlendMode(tile.texture.get(), SDL_BLENDMODE_BLEND);
+            tiles.push_back(std::move(tile));
+        }
+    }
+    return tiles;
+}
+
+void upload_tiles(const std::vector<TextureTile>& tiles, const uint32_t* pixels, int pitch,
+                  const SDL_Rect& rect) {
+    const Uint8* bytes = reinterpret_cast<const Uint8*>(pixels);
+    for (const TextureTile& tile : tiles) {
+        SDL_Rect area;
+        if (!SDL_IntersectRect(&rect, &tile.rect, &area)) continue;
+
+        const Uint8* origin = bytes + static_cast<size_t>(area.y) * pitch +
+                              static_cast<size_t>(area.x) * sizeof(uint32_t);
+        SDL_Rect local{area.x - tile.rect.x, area.y - tile.rect.y, area.w, area.h};
+        if (SDL_UpdateTexture(tile.texture.get(), &local, origin, pitch) != 0) {
+            core::Logger::error("Failed to upload the texture pixels: %s", SDL_GetError());
+        }
+    }
+}
+
+Image Texture2D::decode(const std::string& path) {
+    if (!fs::exists(path)) {
         core::Logger::error("Failed to load the texture, file does not exist");
         throw std::runtime_error("Failed to load the texture, file does not exist");
     }
 
-    SDL_Surface* surface = IMG_Load(m_path.c_str());
+    SDL_Surface* surface = IMG_Load(path.c_str());
     if (surface == nullptr) {
-        core::Logger::error("Failed to load the image %s into a surface: %s", m_path.c_str(),
+        core::Logger::error("Failed to load the image %s into a surface: %s", path.c_str(),
                             IMG_GetError());
         throw std::runtime_error(std::string("Failed to load the image into a surface: ") +
                                  IMG_GetError());
     }
+    return to_image(surface);
+}
 
-    SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
-    SDL_FreeSurface(surface);
-    surface = converted_surface;
+Image Texture2D::decode(const void* data, size_t size) {
+    SDL_Surface* surface = IMG_Load_RW(SDL_RWFromConstMem(data, static_cast<int>(size)), 1);
     if (surface == nullptr) {
-        core::Logger::error("Failed to convert surface to RGBA8888 format: %s", SDL_GetError());
-        throw "unreachable";
+        core::Logger::error("Failed to load the image into a surface: %s", IMG_GetError());
+        throw std::runtime_error(std::string("Failed to load the image into a surface: ") +
+                                 IMG_GetError());
     }
+    return to_image(surface);
+}
 
-    m_pitch = surface->pitch;
-    m_width = surface->w;
-    m_height = surface->h;
+void Texture2D::set_image(SDL_Renderer* renderer, Image image) {
+    std::vector<TextureTile> tiles = create_tiles(renderer, image.width, image.height);
+    if (tiles.size() > 1) {
+        core::Logger::debug("Split the %dx%d texture into %zu tiles of %dx%d", image.width,
+                            image.height, tiles.size(), tiles.front().rect.w,
+                            tiles.front().rect.h);
+    }
+    m_tiles = std::move(tiles);
+    m_mips.clear();
+    m_mips_version = 0;
 
-    m_texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
-                                      SDL_TEXTUREACCESS_STREAMING, m_width, m_height));
-    SDL_SetTextureBlendMode(m_texture.get(), SDL_BLENDMODE_BLEND);
-    if (m_texture == nullptr) {
-        core::Logger::error("Failed to create a texture from a surface: %s", SDL_GetError());
-        throw std::runtime_error(std::string("Failed to create a texture from a surface: %s") +
-                                 SDL_GetError());
+    // A snapshot of the previous pixels keeps them alive, they are freed with the last one
+    m_pixels = std::move(image.pixels);
+    m_width = image.width;
+    m_height = image.height;
+    m_pitch = image.pitch;
+
+    m_dirty_rects.clear();
+    mark_dirty();
+    flush();
+    m_loaded_version = m_version;
+
+    build_mips(renderer);
+}
+
+void Texture2D::build_mips(SDL_Renderer* renderer) {
+    std::weak_ptr<Texture2D> self = weak_from_this();
+    if (m_building_mips || m_pixels == nullptr || self.expired()) return;
+
+    m_building_mips = true;
+    core::async([snapshot = snapshot()] {
+        return downsample_levels(snapshot.pixels, k_max_mip_levels);
+    }).then_on_main([self, renderer, version = m_version](core::Future<std::vector<Image>> levels) {
+        std::shared_ptr<Texture2D> texture = self.lock();
+        if (texture == nullptr) return;
+
+        texture->m_building_mips = false;
+        try {
+            texture->set_mips(renderer, levels.get(), version);
+        } catch (const std::exception& ex) {
+            core::Logger::error("Failed to build the mip levels of %s: %s",
+                                texture->m_path.c_str(), ex.what());
+        }
+    });
+}
+
+void Texture2D::set_mips(SDL_Renderer* renderer, std::vector<Image> levels, uint64_t version) {
+    // Edited or reloaded meanwhile: the next draw at a small scale builds them again
+    if (version != m_version) return;
+
+    std::vector<MipLevel> mips;
+    for (const Image& image : levels) {
+        MipLevel mip;
+        mip.width = image.width;
+        mip.height = image.height;
+        mip.tiles = create_tiles(renderer, image.width, image.height);
+        upload_tiles(mip.tiles, image.pixels.get(), image.pitch, {0, 0, image.width, image.height});
+        mips.push_back(std::move(mip));
     }
+    // The CPU copies of the levels go away here, only the image itself keeps one
+    m_mips = std::move(mips);
+    m_mips_version = version;
+}
+
+bool Texture2D::is_loaded() const { return !m_tiles.empty(); }
+
+bool Texture2D::is_modified() const { return m_version != m_loaded_version; }
+
+size_t Texture2D::num_bytes() const {
+    size_t num_bytes = m_pixels != nullptr ? static_cast<size_t>(m_pitch) * m_height : 0;
+    // The SDL textures are RGBA8888 too, wherever the driver keeps them
+    if (is_loaded()) num_bytes += static_cast<size_t>(m_width) * m_height * 4;
+    for (const MipLevel& mip : m_mips) num_bytes += static_cast<size_t>(mip.width) * mip.height * 4;
+    return num_bytes;
+}
+
+void Texture2D::allocate_pixels() {
+    // A snapshot of the previous pixels keeps them alive, they are freed with the last one
+    m_pixels = allocate_aligned(static_cast<size_t>(m_pitch) * m_height);
+}
+
+PixelView Texture2D::pixels() const { return {m_pixels.get(), m_width, m_height, m_pitch}; }
 
-    void* pixels;
-    int pitch;
-    if (SDL_LockTexture(m_texture.get(), nullptr, &pixels, &pitch) != 0) {
-        core::Logger::error("Failed to lock the texture: %s", SDL_GetError());
-        throw std::runtime_error(std::string("Failed to lock the texture: %s") + SDL_GetError());
+uint32_t* Texture2D::mutable_pixels() {
+    if (m_pixels != nullptr && m_pixels.use_count() > 1) {
+        std::shared_ptr<const uint32_t> shared = m_pixels;
+        allocate_pixels();
+        memcpy(m_pixels.get(), shared.get(), static_cast<size_t>(m_pitch) * m_height);
     }
+    return m_pixels.get();
+}
+
+PixelSnapshot Texture2D::snapshot() const { return {m_pixels, pixels(), m_version}; }
+
+Image Texture2D::image() const { return {m_pixels, m_width, m_height, m_pitch}; }
+
+void Texture2D::mark_dirty(const SDL_Rect& rect) {
+    if (m_pixels == nullptr) return;
+
+    SDL_Rect bounds{0, 0, m_width, m_height};
+    SDL_Rect clipped;
+    if (!SDL_IntersectRect(&rect, &bounds, &clipped)) return;
+
+    m_dirty_rects.push_back(clipped);
+    m_version = s_next_version++;
+}
+
+void Texture2D::mark_dirty() { mark_dirty({0, 0, m_width, m_height}); }
+
+bool Texture2D::is_dirty() const { return !m_dirty_rects.empty(); }
+
+uint64_t Texture2D::version() const { return m_version; }
+
+void Texture2D::restore_version(uint64_t version) { m_version = version; }
+
+namespace {
+
+int64_t area(const SDL_Rect& rect) { return static_cast<int64_t>(rect.w) * rect.h; }
+
+// Two regions are uploaded as one when their union does not cost more pixels than uploading
+// them separately would, i.e. they overlap or nearly touch
+bool should_merge(const SDL_Rect& lhs, const SDL_Rect& rhs, SDL_Rect& merged) {
+    SDL_UnionRect(&lhs, &rhs, &merged);
+    return area(merged) <= area(lhs) + area(rhs);
+}
+
+}  // namespace
 
-    Uint8* dst = static_cast<Uint8*>(pixels);
-    Uint8* src = static_cast<Uint8*>(surface->pixels);
-    for (int row = 0; row < m_height; ++row) {
-        memcpy(dst + row * pitch, src + row * surface->pitch, surface->pitch);
+void Texture2D::flush() {
+    if (m_dirty_rects.empty()) return;
+    if (m_tiles.empty() || m_pixels == nullptr) {
+        m_dirty_rects.clear();
+        return;
     }
 
-    SDL_UnlockTexture(m_texture.get());
-    SDL_FreeSurface(surface);
+    // Merging can create new overlaps, so go again until the set is stable
+    bool merged_any = true;
+    while (merged_any && m_dirty_rects.size() > 1) {
+        merged_any = false;
+        for (size_t i = 0; i < m_dirty_rects.size(); ++i) {
+            for (size_t j = i + 1; j < m_dirty_rects.size();) {
+                SDL_Rect merged;
+                if (should_merge(m_dirty_rects[i], m_dirty_rects[j], merged)) {
+                    m_dirty_rects[i] = merged;
+                    m_dirty_rects[j] = m_dirty_rects.back();
+                    m_dirty_rects.pop_back();
+                    merged_any = true;
+                } else {
+                    ++j;
+                }
+            }
+        }
+    }
+
+    if (m_dirty_rects.size() > k_max_dirty_rects) {
+        SDL_Rect bounding_box = m_dirty_rects.front();
+        for (const SDL_Rect& rect : m_dirty_rects) {
+            SDL_UnionRect(&bounding_box, &rect, &bounding_box);
+        }
+        m_dirty_rects.assign(1, bounding_box);
+    }
+
+    for (const SDL_Rect& rect : m_dirty_rects) upload_tiles(m_tiles, m_pixels.get(), m_pitch, rect);
+    m_dirty_rects.clear();
+}
+
+const std::vector<TextureTile>& Texture2D::tiles() const { return m_tiles; }
+
+bool visible_source(SDL_Renderer* renderer, const SDL_Rect& source, const SDL_Rect& destination,
+                    SDL_Rect* visible) {
+    if (source.w <= 0 || source.h <= 0 || destination.w <= 0 || destination.h <= 0) return false;
+
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer, &viewport);
+    const double scale_x = static_cast<double>(destination.w) / source.w;
+    const double scale_y = static_cast<double>(destination.h) / source.h;
+
+    // The viewport in pixels of the source, rounded outwards
+    SDL_Rect on_screen{static_cast<int>(std::floor(source.x - destination.x / scale_x)),
+                       static_cast<int>(std::floor(source.y - destination.y / scale_y)), 0, 0};
+    on_screen.w =
+        static_cast<int>(std::ceil(source.x + (viewport.w - destination.x) / scale_x)) -
+        on_screen.x;
+    on_screen.h =
+        static_cast<int>(std::ceil(source.y + (viewport.h - destination.y) / scale_y)) -
+        on_screen.y;
+    return SDL_IntersectRect(&source, &on_screen, visible);
+}
+
+SDL_Rect map_to_destination(const SDL_Rect& source, const SDL_Rect& destination,
+                            const SDL_Rect& part) {
+    const double scale_x = static_cast<double>(destination.w) / source.w;
+    const double scale_y = static_cast<double>(destination.h) / source.h;
+    auto to_destination_x = [&](int x) {
+        return destination.x + static_cast<int>(std::floor((x - source.x) * scale_x));
+    };
+    auto to_destination_y = [&](int y) {
+        return destination.y + static_cast<int>(std::floor((y - source.y) * scale_y));
+    };
+
+    SDL_Rect target{to_destination_x(part.x), to_destination_y(part.y), 0, 0};
+    target.w = to_destination_x(part.x + part.w) - target.x;
+    target.h = to_destination_y(part.y + part.h) - target.y;
+    return target;
 }
 
-SDL_Texture* Texture2D::get() const { return m_texture.get(); }
+void draw_tiles(SDL_Renderer* renderer, const std::vector<TextureTile>& tiles,
+                const SDL_Rect& source, const SDL_Rect& destination) {
+    // Zoomed in, only the pixels that cover the viewport are copied, so the renderer never
+    // clips spans many times its size
+    SDL_Rect visible;
+    if (!visible_source(renderer, source, destination, &visible)) return;
+
+    for (const TextureTile& tile : tiles) {
+        SDL_Rect part;
+        if (!SDL_IntersectRect(&visible, &tile.rect, &part)) continue;
+
+        SDL_Rect target = map_to_destination(source, destination, part);
+        SDL_Rect local{part.x - tile.rect.x, part.y - tile.rect.y, part.w, part.h};
+        SDL_RenderCopy(renderer, tile.texture.get(), &local, &target);
+    }
+}
+
+void Texture2D::draw(SDL_Renderer* renderer, const SDL_Rect& source, const SDL_Rect& destination) {
+    if (source.w <= 0 || source.h <= 0 || destination.w <= 0 || destination.h <= 0) return;
+
+    const int level = mip_level(renderer, std::max(static_cast<double>(destination.w) / source.w,
+                                                   static_cast<double>(destination.h) / source.h));
+    const std::vector<TextureTile>& tiles = level == 0 ? m_tiles : m_mips[level - 1].tiles;
+
+    // The source in pixels of the level, rounded to the nearest one. The whole of it is drawn to
+    // the destination, so the edges stay where they are at any level.
+    SDL_Rect level_source = source;
+    if (level > 0) {
+        const MipLevel& mip = m_mips[level - 1];
+        const double ratio_x = static_cast<double>(m_width) / mip.width;
+        const double ratio_y = static_cast<double>(m_height) / mip.height;
+        level_source.x = std::min(static_cast<int>(std::lround(source.x / ratio_x)), mip.width - 1);
+        level_source.y =
+            std::min(static_cast<int>(std::lround(source.y / ratio_y)), mip.height - 1);
+        level_source.w = std::max(
+            static_cast<int>(std::lround((source.x + source.w) / ratio_x)) - level_source.x, 1);
+        level_source.h = std::max(
+            static_cast<int>(std::lround((source.y + source.h) / ratio_y)) - level_source.y, 1);
+    }
+    draw_tiles(renderer, tiles, level_source, destination);
+}
+
+int Texture2D::mip_level(SDL_Renderer* renderer, double scale) {
+    if (scale >= 0.5 || scale <= 0.0) return 0;
+
+    if (m_mips_version != m_version) {
+        // Edited since the levels were built, draw the image itself until they are rebuilt
+        build_mips(renderer);
+        return 0;
+    }
+    const int level = static_cast<int>(std::floor(std::log2(1.0 / scale)));
+    return std::min(level, static_cast<int>(m_mips.size()));
+}
 
 int Texture2D::width() const { return m_width; }
 
@@ -0,0 +1,96 @@
+#include <cstring>
+#include <utils/hash.hpp>
+
+namespace piksy {
+namespace utils {
+namespace hash {
+
+namespace {
+
+constexpr uint64_t k_prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t k_prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t k_prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t k_prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t k_prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+// Little endian loads, the hash of a file does not depend on the machine
+inline uint64_t read64(const uint8_t* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) value = (value << 8) | bytes[i];
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+inline uint64_t round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * k_prime2;
+    return rotl(accumulator, 31) * k_prime1;
+}
+
+inline uint64_t merge_round(uint64_t accumulator, uint64_t value) {
+    accumulator ^= round(0, value);
+    return accumulator * k_prime1 + k_prime4;
+}
+
+}  // namespace
+
+uint64_t xxhash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        // Four independent lanes of 8 bytes, the CPU runs them in parallel
+        uint64_t v1 = seed + k_prime1 + k_prime2;
+        uint64_t v2 = seed + k_prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - k_prime1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = round(v1, read64(bytes));
+            v2 = round(v2, read64(bytes + 8));
+            v3 = round(v3, read64(bytes + 16));
+            v4 = round(v4, read64(bytes + 24));
+            bytes += 32;
+        } while (bytes <= limit);
+
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+    } else {
+        hash = seed + k_prime5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    for (; bytes + 8 <= end; bytes += 8) {
+        hash ^= round(0, read64(bytes));
+        hash = rotl(hash, 27) * k_prime1 + k_prime4;
+    }
+    if (bytes + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(bytes)) * k_prime1;
+        hash = rotl(hash, 23) * k_prime2 + k_prime3;
+        bytes += 4;
+    }
+    for (; bytes < end; ++bytes) {
+        hash ^= (*bytes) * k_prime5;
+        hash = rotl(hash, 11) * k_prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= k_prime2;
+    hash ^= hash >> 29;
+    hash *= k_prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+}  // namespace hash
+}  // namespace utils
+}  // namespace piksy
@@ -0,0 +1,578 @@
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <core/thread_pool.hpp>
+#include <mutex>
+#include <utils/pixels.hpp>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIKSY_PIXELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace piksy {
+namespace utils {
+namespace pixels {
+
+namespace {
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+SimdLevel detect_simd_level() {
+#if defined(PIKSY_PIXELS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+// Bounds of the pixels written by a kernel, grown one pixel or one vector at a time
+struct Bounds {
+    int min_x = INT_MAX, min_y = INT_MAX;
+    int max_x = -1, max_y = -1;
+
+    bool empty() const { return max_x < 0; }
+
+    void add(int x) {
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+    }
+
+    // `bits` holds one bit per written pixel of the vector starting at `x`
+    void add_bits(int x, unsigned bits) {
+        min_x = std::min(min_x, x + __builtin_ctz(bits));
+        max_x = std::max(max_x, x + 31 - __builtin_clz(bits));
+    }
+
+    void add_row(int y) {
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+
+    void merge(const Bounds& other) {
+        if (other.empty()) return;
+        min_x = std::min(min_x, other.min_x);
+        max_x = std::max(max_x, other.max_x);
+        min_y = std::min(min_y, other.min_y);
+        max_y = std::max(max_y, other.max_y);
+    }
+
+    PixelRect rect() const {
+        if (empty()) return {};
+        return {min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+    }
+};
+
+size_t swap_row_scalar(uint32_t* row, int begin, int end, uint32_t from, uint32_t to,
+                       int threshold_sq, Bounds& bounds) {
+    size_t num_replaced = 0;
+    for (int x = begin; x < end; ++x) {
+        if (distance_sq_rgba8888(row[x], from) <= threshold_sq) {
+            row[x] = to;
+            bounds.add(x);
+            ++num_replaced;
+        }
+    }
+    return num_replaced;
+}
+
+#if defined(PIKSY_PIXELS_X86)
+
+// Per pixel squared distances of 4 pixels: the bytes are widened to 16 bits and `madd` sums the
+// squares two channels at a time, the even/odd shuffle then adds the two halves of each pixel.
+// The channel order does not matter since every channel is weighted the same.
+__attribute__((target("sse2"))) inline __m128i distance_sq_sse2(__m128i pixels, __m128i from) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i delta_lo =
+        _mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(from, zero));
+    __m128i delta_hi =
+        _mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(from, zero));
+    __m128 sum_lo = _mm_castsi128_ps(_mm_madd_epi16(delta_lo, delta_lo));
+    __m128 sum_hi = _mm_castsi128_ps(_mm_madd_epi16(delta_hi, delta_hi));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+__attribute__((target("sse2"))) size_t swap_row_sse2(uint32_t* row, int begin, int width,
+                                                     uint32_t from, uint32_t to, int threshold_sq,
+                                                     Bounds& bounds) {
+    const __m128i from_v = _mm_set1_epi32(static_cast<int>(from));
+    const __m128i to_v = _mm_set1_epi32(static_cast<int>(to));
+    const __m128i threshold_v = _mm_set1_epi32(threshold_sq);
+
+    size_t num_replaced = 0;
+    int x = begin;
+    for (; x + 4 <= width; x += 4) {
+        __m128i* ptr = reinterpret_cast<__m128i*>(row + x);
+        __m128i pixels = _mm_loadu_si128(ptr);
+        __m128i far = _mm_cmpgt_epi32(distance_sq_sse2(pixels, from_v), threshold_v);
+
+        int far_bits = _mm_movemask_ps(_mm_castsi128_ps(far));
+        if (far_bits == 0xF) continue;
+
+        _mm_storeu_si128(ptr,
+                         _mm_or_si128(_mm_and_si128(far, pixels), _mm_andnot_si128(far, to_v)));
+        bounds.add_bits(x, ~far_bits & 0xF);
+        num_replaced += 4 - __builtin_popcount(far_bits);
+    }
+    return num_replaced + swap_row_scalar(row, x, width, from, to, threshold_sq, bounds);
+}
+
+// Same as the SSE2 version on 8 pixels: unpack and shuffle work per 128 bit lane, so each lane
+// ends up holding the distances of its own 4 pixels in order.
+__attribute__((target("avx2"))) size_t swap_row_avx2(uint32_t* row, int width, uint32_t from,
+                                                     uint32_t to, int threshold_sq,
+                                                     Bounds& bounds) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i from_v = _mm256_set1_epi32(static_cast<int>(from));
+    const __m256i from_lo = _mm256_unpacklo_epi8(from_v, zero);
+    const __m256i from_hi = _mm256_unpackhi_epi8(from_v, zero);
+    const __m256i to_v = _mm256_set1_epi32(static_cast<int>(to));
+    const __m256i threshold_v = _mm256_set1_epi32(threshold_sq);
+
+    size_t num_replaced = 0;
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i* ptr = reinterpret_cast<__m256i*>(row + x);
+        __m256i pixels = _mm256_loadu_si256(ptr);
+
+        __m256i delta_lo = _mm256_sub_epi16(_mm256_unpacklo_epi8(pixels, zero), from_lo);
+        __m256i delta_hi = _mm256_sub_epi16(_mm256_unpackhi_epi8(pixels, zero), from_hi);
+        __m256 sum_lo = _mm256_castsi256_ps(_mm256_madd_epi16(delta_lo, delta_lo));
+        __m256 sum_hi = _mm256_castsi256_ps(_mm256_madd_epi16(delta_hi, delta_hi));
+        __m256i even =
+            _mm256_castps_si256(_mm256_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256i odd =
+            _mm256_castps_si256(_mm256_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m256i far = _mm256_cmpgt_epi32(_mm256_add_epi32(even, odd), threshold_v);
+
+        int far_bits = _mm256_movemask_ps(_mm256_castsi256_ps(far));
+        if (far_bits == 0xFF) continue;
+
+        _mm256_storeu_si256(ptr, _mm256_blendv_epi8(to_v, pixels, far));
+        bounds.add_bits(x, ~far_bits & 0xFF);
+        num_replaced += 8 - __builtin_popcount(far_bits);
+    }
+    return num_replaced + swap_row_sse2(row, x, width, from, to, threshold_sq, bounds);
+}
+
+__attribute__((target("sse2"))) void distance_row_sse2(const uint32_t* row, int width,
+                                                      uint32_t color, uint16_t* out) {
+    const __m128i color_v = _mm_set1_epi32(static_cast<int>(color));
+    const __m128i bias_32 = _mm_set1_epi32(0x8000);
+    const __m128i bias_16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = distance_sq_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)),
+                                      color_v);
+        __m128i hi = distance_sq_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 4)), color_v);
+        // SSE2 only has a signed saturating pack: shift the range down, pack, shift it back up
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias_32), _mm_sub_epi32(hi, bias_32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_add_epi16(packed, bias_16));
+    }
+    for (; x < width; ++x) {
+        out[x] = static_cast<uint16_t>(std::min(distance_sq_rgba8888(row[x], color), 0xFFFF));
+    }
+}
+
+__attribute__((target("sse2"))) size_t overlay_row_sse2(const uint16_t* distances, int width,
+                                                        int threshold_sq, uint32_t highlight,
+                                                        uint32_t* out) {
+    // Unsigned 16 bit compare through the signed one by flipping the sign bits
+    const __m128i bias = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+    const __m128i threshold_v =
+        _mm_xor_si128(_mm_set1_epi16(static_cast<int16_t>(threshold_sq)), bias);
+    const __m128i all_ones = _mm_set1_epi16(-1);
+    const __m128i highlight_v = _mm_set1_epi32(static_cast<int>(highlight));
+
+    size_t num_highlighted = 0;
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(distances + x));
+        __m128i far = _mm_cmpgt_epi16(_mm_xor_si128(values, bias), threshold_v);
+        __m128i near = _mm_xor_si128(far, all_ones);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                         _mm_and_si128(_mm_unpacklo_epi16(near, near), highlight_v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 4),
+                         _mm_and_si128(_mm_unpackhi_epi16(near, near), highlight_v));
+        num_highlighted += __builtin_popcount(_mm_movemask_epi8(near)) / 2;
+    }
+    for (; x < width; ++x) {
+        bool is_near = distances[x] <= threshold_sq;
+        out[x] = is_near ? highlight : 0;
+        num_highlighted += is_near;
+    }
+    return num_highlighted;
+}
+
+// Weighted sums of 4 pixels, `madd` adds the channels two by two like distance_sq_sse2
+__attribute__((target("sse2"))) inline __m128i gray_weighted_sse2(__m128i pixels,
+                                                                  __m128i weights) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights));
+    __m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+// Bits of 4 pixels at a time from the compare mask, 64 pixels per output word
+__attribute__((target("sse2"))) int gray_mask_bits_sse2(const uint32_t* row, int width,
+                                                        int min_weighted, uint64_t* out) {
+    const __m128i weights = _mm_setr_epi16(k_gray_weights[0], k_gray_weights[1],
+                                           k_gray_weights[2], 0, k_gray_weights[0],
+                                           k_gray_weights[1], k_gray_weights[2], 0);
+    const __m128i below = _mm_set1_epi32(min_weighted - 1);
+
+    int x = 0;
+    for (; x + 64 <= width; x += 64) {
+        uint64_t word = 0;
+        for (int i = 0; i < 64; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + i));
+            __m128i above = _mm_cmpgt_epi32(gray_weighted_sse2(pixels, weights), below);
+            word |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(above))) << i;
+        }
+        out[x >> 6] = word;
+    }
+    return x;
+}
+
+// 4 output pixels from 8 pixels of two rows: the rows are added as 16 bit channels, then the
+// 64 bit halves holding neighbouring pixels are added together
+__attribute__((target("sse2"))) int downsample_row_sse2(const uint32_t* top,
+                                                        const uint32_t* bottom, int out_width,
+                                                        uint32_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(2);
+
+    auto average_pairs = [&](__m128i top_pixels, __m128i bottom_pixels) {
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top_pixels, zero),
+                                   _mm_unpacklo_epi8(bottom_pixels, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top_pixels, zero),
+                                   _mm_unpackhi_epi8(bottom_pixels, zero));
+        __m128i sums = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        return _mm_srli_epi16(_mm_add_epi16(sums, rounding), 2);
+    };
+
+    int x = 0;
+    for (; x + 4 <= out_width; x += 4) {
+        const __m128i* top_v = reinterpret_cast<const __m128i*>(top + 2 * x);
+        const __m128i* bottom_v = reinterpret_cast<const __m128i*>(bottom + 2 * x);
+        __m128i first = average_pairs(_mm_loadu_si128(top_v), _mm_loadu_si128(bottom_v));
+        __m128i second =
+            average_pairs(_mm_loadu_si128(top_v + 1), _mm_loadu_si128(bottom_v + 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(first, second));
+    }
+    return x;
+}
+
+#endif
+
+// Output pixels from `begin`, an odd last column is averaged with itself
+void downsample_row_scalar(const uint32_t* top, const uint32_t* bottom, int width, int begin,
+                           int out_width, uint32_t* out) {
+    for (int x = begin; x < out_width; ++x) {
+        const int left = 2 * x;
+        const int right = std::min(left + 1, width - 1);
+        uint32_t pixel = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t sum = ((top[left] >> shift) & 0xFF) + ((top[right] >> shift) & 0xFF) +
+                           ((bottom[left] >> shift) & 0xFF) + ((bottom[right] >> shift) & 0xFF);
+            pixel |= ((sum + 2) >> 2) << shift;
+        }
+        out[x] = pixel;
+    }
+}
+
+void downsample_row(const uint32_t* top, const uint32_t* bottom, int width, uint32_t* out) {
+    const int out_width = (width + 1) / 2;
+    int x = 0;
+#if defined(PIKSY_PIXELS_X86)
+    // The vectors read 2 source pixels per output pixel, stop before an odd last column
+    if (simd_level() != SimdLevel::Scalar) x = downsample_row_sse2(top, bottom, width / 2, out);
+#endif
+    downsample_row_scalar(top, bottom, width, x, out_width, out);
+}
+
+void distance_row(const uint32_t* row, int width, uint32_t color, uint16_t* out) {
+#if defined(PIKSY_PIXELS_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        distance_row_sse2(row, width, color, out);
+        return;
+    }
+#endif
+    for (int x = 0; x < width; ++x) {
+        out[x] = static_cast<uint16_t>(std::min(distance_sq_rgba8888(row[x], color), 0xFFFF));
+    }
+}
+
+size_t overlay_row(const uint16_t* distances, int width, int threshold_sq, uint32_t highlight,
+                   uint32_t* out) {
+#if defined(PIKSY_PIXELS_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        return overlay_row_sse2(distances, width, threshold_sq, highlight, out);
+    }
+#endif
+    size_t num_highlighted = 0;
+    for (int x = 0; x < width; ++x) {
+        bool is_near = distances[x] <= threshold_sq;
+        out[x] = is_near ? highlight : 0;
+        num_highlighted += is_near;
+    }
+    return num_highlighted;
+}
+
+size_t swap_row(uint32_t* row, int width, uint32_t from, uint32_t to, int threshold_sq,
+                Bounds& bounds) {
+    switch (simd_level()) {
+#if defined(PIKSY_PIXELS_X86)
+        case SimdLevel::AVX2:
+            return swap_row_avx2(row, width, from, to, threshold_sq, bounds);
+        case SimdLevel::SSE2:
+            return swap_row_sse2(row, 0, width, from, to, threshold_sq, bounds);
+#endif
+        default:
+            return swap_row_scalar(row, 0, width, from, to, threshold_sq, bounds);
+    }
+}
+
+// Direct mapped cache from a pixel value to its remapped value. Sprite sheets usually hold a few
+// hundred distinct colors at most so nearly every lookup hits.
+class PaletteCache {
+   public:
+    PaletteCache(const PaletteEntry* entries, size_t num_entries)
+        : m_entries(entries), m_num_entries(num_entries), m_slots(1u << k_bits) {}
+
+    // Returns true and writes the remapped value in `out` if `pixel` matches an entry
+    bool lookup(uint32_t pixel, uint32_t& out) {
+        Slot& slot = m_slots[(pixel * 0x9E3779B1u) >> (32 - k_bits)];
+        if (!slot.filled || slot.key != pixel) {
+            slot.key = pixel;
+            slot.filled = true;
+            slot.matched = resolve(pixel, slot.value);
+        }
+        out = slot.value;
+        return slot.matched;
+    }
+
+   private:
+    bool resolve(uint32_t pixel, uint32_t& out) const {
+        for (size_t i = 0; i < m_num_entries; ++i) {
+            const PaletteEntry& entry = m_entries[i];
+            if (distance_sq_rgba8888(pixel, entry.from) <= entry.threshold * entry.threshold) {
+                out = entry.to;
+                return true;
+            }
+        }
+        out = pixel;
+        return false;
+    }
+
+   private:
+    static constexpr int k_bits = 12;
+
+    struct Slot {
+        uint32_t key = 0;
+        uint32_t value = 0;
+        bool filled = false;
+        bool matched = false;
+    };
+
+    const PaletteEntry* m_entries;
+    size_t m_num_entries;
+    std::vector<Slot> m_slots;
+};
+
+// Aim for chunks of ~64K pixels so small textures stay on the calling thread
+int rows_per_chunk(int width) { return std::max(1, (1 << 16) / std::max(width, 1)); }
+
+}  // namespace
+
+size_t swap_color_rgba8888(uint32_t* pixels, int width, int height, int pitch, uint32_t from,
+                           uint32_t to, uint8_t threshold, PixelRect* out_changed) {
+    if (out_changed != nullptr) *out_changed = {};
+    if (pixels == nullptr || width <= 0 || height <= 0) return 0;
+
+    const int threshold_sq = threshold * threshold;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(pixels);
+
+    std::atomic<size_t> num_replaced{0};
+    std::mutex bounds_mutex;
+    Bounds bounds;
+    core::ThreadPool::global().parallel_for(
+        0, height, rows_per_chunk(width), [&](int row_begin, int row_end) {
+            size_t chunk_replaced = 0;
+            Bounds chunk_bounds;
+            for (int y = row_begin; y < row_end; ++y) {
+                uint32_t* row = reinterpret_cast<uint32_t*>(bytes + static_cast<size_t>(y) * pitch);
+                size_t row_replaced = swap_row(row, width, from, to, threshold_sq, chunk_bounds);
+                if (row_replaced > 0) chunk_bounds.add_row(y);
+                chunk_replaced += row_replaced;
+            }
+            num_replaced += chunk_replaced;
+
+            std::lock_guard<std::mutex> lock(bounds_mutex);
+            bounds.merge(chunk_bounds);
+        });
+
+    if (out_changed != nullptr) *out_changed = bounds.rect();
+    return num_replaced;
+}
+
+size_t remap_palette_rgba8888(uint32_t* pixels, int width, int height, int pitch,
+                              const PaletteEntry* entries, size_t num_entries,
+                              PixelRect* out_changed) {
+    if (out_changed != nullptr) *out_changed = {};
+    if (pixels == nullptr || width <= 0 || height <= 0 || num_entries == 0) return 0;
+
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(pixels);
+
+    std::atomic<size_t> num_remapped{0};
+    std::mutex bounds_mutex;
+    Bounds bounds;
+    core::ThreadPool::global().parallel_for(
+        0, height, rows_per_chunk(width), [&](int row_begin, int row_end) {
+            PaletteCache cache(entries, num_entries);
+            size_t chunk_remapped = 0;
+            Bounds chunk_bounds;
+
+            // Runs of identical pixels are common, skip the cache for them
+            uint32_t last_pixel = 0, last_value = 0;
+            bool last_matched = cache.lookup(last_pixel, last_value);
+
+            for (int y = row_begin; y < row_end; ++y) {
+                uint32_t* row = reinterpret_cast<uint32_t*>(bytes + static_cast<size_t>(y) * pitch);
+                size_t row_remapped = 0;
+                for (int x = 0; x < width; ++x) {
+                    if (row[x] != last_pixel) {
+                        last_pixel = row[x];
+                        last_matched = cache.lookup(last_pixel, last_value);
+                    }
+                    if (last_matched) {
+                        row[x] = last_value;
+                        chunk_bounds.add(x);
+                        ++row_remapped;
+                    }
+                }
+                if (row_remapped > 0) chunk_bounds.add_row(y);
+                chunk_remapped += row_remapped;
+            }
+            num_remapped += chunk_remapped;
+
+            std::lock_guard<std::mutex> lock(bounds_mutex);
+            bounds.merge(chunk_bounds);
+        });
+
+    if (out_changed != nullptr) *out_changed = bounds.rect();
+    return num_remapped;
+}
+
+void color_distance_rgba8888(const uint32_t* pixels, int width, int height, int pitch,
+                             uint32_t color, uint16_t* out_distances) {
+    if (pixels == nullptr || out_distances == nullptr || width <= 0 || height <= 0) return;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+    core::ThreadPool::global().parallel_for(
+        0, height, rows_per_chunk(width), [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y) {
+                const uint32_t* row =
+                    reinterpret_cast<const uint32_t*>(bytes + static_cast<size_t>(y) * pitch);
+                distance_row(row, width, color, out_distances + static_cast<size_t>(y) * width);
+            }
+        });
+}
+
+size_t threshold_overlay_rgba8888(const uint16_t* distances, int width, int height,
+                                  uint8_t threshold, uint32_t highlight, uint32_t* out_pixels,
+                                  int out_pitch) {
+    if (distances == nullptr || out_pixels == nullptr || width <= 0 || height <= 0) return 0;
+
+    const int threshold_sq = threshold * threshold;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(out_pixels);
+
+    std::atomic<size_t> num_highlighted{0};
+    core::ThreadPool::global().parallel_for(
+        0, height, rows_per_chunk(width), [&](int row_begin, int row_end) {
+            size_t chunk_highlighted = 0;
+            for (int y = row_begin; y < row_end; ++y) {
+                uint32_t* row =
+                    reinterpret_cast<uint32_t*>(bytes + static_cast<size_t>(y) * out_pitch);
+                chunk_highlighted += overlay_row(distances + static_cast<size_t>(y) * width, width,
+                                                 threshold_sq, highlight, row);
+            }
+            num_highlighted += chunk_highlighted;
+        });
+
+    return num_highlighted;
+}
+
+void downsample_box_2x_rgba8888(const uint32_t* pixels, int width, int height, int pitch,
+                                uint32_t* out_pixels, int out_pitch) {
+    if (pixels == nullptr || out_pixels == nullptr || width <= 0 || height <= 0) return;
+
+    const int out_height = (height + 1) / 2;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+    uint8_t* out_bytes = reinterpret_cast<uint8_t*>(out_pixels);
+    core::ThreadPool::global().parallel_for(
+        0, out_height, rows_per_chunk(width * 2), [&](int row_begin, int row_end) {
+            for (int y = row_begin; y < row_end; ++y) {
+                const int bottom_y = std::min(2 * y + 1, height - 1);
+                const uint32_t* top = reinterpret_cast<const uint32_t*>(
+                    bytes + static_cast<size_t>(2 * y) * pitch);
+                const uint32_t* bottom = reinterpret_cast<const uint32_t*>(
+                    bytes + static_cast<size_t>(bottom_y) * pitch);
+                downsample_row(top, bottom, width,
+                               reinterpret_cast<uint32_t*>(
+                                   out_bytes + static_cast<size_t>(y) * out_pitch));
+            }
+        });
+}
+
+void gray_mask_bits_rgba8888(const uint32_t* row, int width, int threshold, uint64_t* out_bits) {
+    // gray > threshold, with gray = (weighted + half) >> shift
+    const int min_weighted =
+        ((std::clamp(threshold, -1, 255) + 1) << k_gray_shift) - (1 << (k_gray_shift - 1));
+
+    int x = 0;
+#if defined(PIKSY_PIXELS_X86)
+    if (simd_level() != SimdLevel::Scalar) {
+        x = gray_mask_bits_sse2(row, width, min_weighted, out_bits);
+    }
+#endif
+    if (x == width) return;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(row);
+    std::fill(out_bits + (x >> 6), out_bits + ((width + 63) >> 6), 0);
+    for (; x < width; ++x) {
+        bool above = k_gray_weights[0] * bytes[4 * x] + k_gray_weights[1] * bytes[4 * x + 1] +
+                         k_gray_weights[2] * bytes[4 * x + 2] >=
+                     min_weighted;
+        out_bits[x >> 6] |= static_cast<uint64_t>(above) << (x & 63);
+    }
+}
+
+const char* simd_level_name() {
+    switch (simd_level()) {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        default:
+            return "Scalar";
+    }
+}
+
+}  // namespace pixels
+}  // namespace utils
+}  // namespace piksy
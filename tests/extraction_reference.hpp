@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <extraction/labeller.hpp>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <rendering/texture2D.hpp>
+#include <vector>
+
+namespace piksy {
+namespace tests {
+
+/// Boxes of the sprites of `pixels` found by the OpenCV pipeline the labeller replaced, in the
+/// order findContours returns them
+inline std::vector<cv::Rect> reference_frames(const rendering::PixelView &pixels,
+                                              const extraction::ExtractionSettings &settings) {
+    cv::Mat mat(pixels.height, pixels.width, CV_8UC4, const_cast<uint32_t *>(pixels.pixels),
+                pixels.pitch);
+    cv::Mat mat_gray;
+    cv::cvtColor(mat, mat_gray, cv::COLOR_RGBA2GRAY);
+
+    cv::Mat thresholded;
+    cv::threshold(mat_gray, thresholded, settings.threshold, 255, cv::THRESH_BINARY);
+
+    const int dilation = settings.dilation;
+    cv::Mat element =
+        cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2 * dilation + 1, 2 * dilation + 1),
+                                  cv::Point(dilation, dilation));
+    cv::Mat dilated;
+    cv::dilate(thresholded, dilated, element);
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(dilated, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    std::vector<cv::Rect> frames;
+    frames.reserve(contours.size());
+    for (const auto &contour : contours) frames.push_back(cv::boundingRect(contour));
+    return frames;
+}
+
+/// Whether the labeller found the same boxes as OpenCV, in the same order
+inline bool same_frames(const std::vector<extraction::Component> &components,
+                        const std::vector<cv::Rect> &frames) {
+    if (components.size() != frames.size()) return false;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const extraction::Component &component = components[i];
+        if (component.x != frames[i].x || component.y != frames[i].y ||
+            component.w != frames[i].width || component.h != frames[i].height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// RGBA8888 pixels owning their memory, rows may be padded
+struct Sheet {
+    int width = 0;
+    int height = 0;
+    int stride = 0;  // In pixels
+    std::vector<uint32_t> pixels;
+
+    Sheet(int width, int height, int padding = 0)
+        : width(width),
+          height(height),
+          stride(width + padding),
+          pixels(static_cast<size_t>(stride) * height, 0) {}
+
+    rendering::PixelView view() const {
+        return {pixels.data(), width, height, stride * static_cast<int>(sizeof(uint32_t))};
+    }
+
+    /// Fill a rectangle, clipped to the sheet
+    void fill(int x, int y, int w, int h, uint32_t color) {
+        for (int row = std::max(y, 0); row < std::min(y + h, height); ++row) {
+            for (int column = std::max(x, 0); column < std::min(x + w, width); ++column) {
+                pixels[static_cast<size_t>(row) * stride + column] = color;
+            }
+        }
+    }
+
+    /// Outline of a rectangle `thickness` pixels wide, clipped to the sheet
+    void frame(int x, int y, int w, int h, int thickness, uint32_t color) {
+        fill(x, y, w, thickness, color);
+        fill(x, y + h - thickness, w, thickness, color);
+        fill(x, y, thickness, h, color);
+        fill(x + w - thickness, y, thickness, h, color);
+    }
+};
+
+/// A color whose gray level is often close to the low thresholds, or transparent black
+inline uint32_t random_color(std::mt19937 &rng) {
+    switch (rng() % 4) {
+        case 0:
+            return 0;
+        case 1:
+            // Every byte small, the gray level lands around 0-3
+            return static_cast<uint32_t>(rng() & 0x03030303u);
+        default:
+            return static_cast<uint32_t>(rng());
+    }
+}
+
+/// Sheet mixing what a labeller gets wrong first: filled sprites, rings with sprites nested in
+/// their hole, sprites cut by the borders, single pixels and colors around the threshold
+inline Sheet random_sheet(std::mt19937 &rng, int width, int height) {
+    Sheet sheet(width, height, static_cast<int>(rng() % 4));
+    const int num_shapes = 1 + static_cast<int>(rng() % 24);
+    for (int i = 0; i < num_shapes; ++i) {
+        // Positions may start outside the sheet, so shapes touch or cross the borders
+        const int x = static_cast<int>(rng() % (width + 8)) - 4;
+        const int y = static_cast<int>(rng() % (height + 8)) - 4;
+        const int w = 1 + static_cast<int>(rng() % std::max(1, width / 2));
+        const int h = 1 + static_cast<int>(rng() % std::max(1, height / 2));
+        const uint32_t color = random_color(rng);
+
+        switch (rng() % 4) {
+            case 0:
+                sheet.fill(x, y, w, h, color);
+                break;
+            case 1: {
+                const int thickness = 1 + static_cast<int>(rng() % 3);
+                sheet.frame(x, y, w + 2 * thickness, h + 2 * thickness, thickness, color);
+                // A sprite in the hole, sometimes far enough to stay separate once dilated
+                const int margin = static_cast<int>(rng() % 8);
+                if (w > 2 * margin && h > 2 * margin) {
+                    sheet.fill(x + thickness + margin, y + thickness + margin, w - 2 * margin,
+                               h - 2 * margin, random_color(rng));
+                }
+                break;
+            }
+            case 2:
+                sheet.fill(x, y, 1, 1, color);
+                break;
+            default:
+                for (int j = 0; j < w; ++j) {
+                    sheet.fill(x + static_cast<int>(rng() % (w + 1)),
+                               y + static_cast<int>(rng() % (h + 1)), 1, 1, color);
+                }
+                break;
+        }
+    }
+    return sheet;
+}
+
+}  // namespace tests
+}  // namespace piksy
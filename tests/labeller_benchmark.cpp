@@ -0,0 +1,83 @@
+// Times extraction::label_components against the OpenCV pipeline it replaced on a large sheet.
+// Build with BUILD_TYPE=Release for meaningful numbers.
+// Usage: labeller_benchmark [number of runs]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <extraction/labeller.hpp>
+#include <random>
+#include <vector>
+
+#include "extraction_reference.hpp"
+
+using namespace piksy;
+
+namespace {
+
+constexpr int k_sheet_size = 4096;
+constexpr int k_cell_size = 64;  // One sprite per cell, 4096 sprites
+
+// Grid of sprites of random sizes and colors, some of them rings around a smaller sprite
+tests::Sheet make_sheet() {
+    std::mt19937 rng(42);
+    tests::Sheet sheet(k_sheet_size, k_sheet_size);
+    for (int y = 0; y < k_sheet_size; y += k_cell_size) {
+        for (int x = 0; x < k_sheet_size; x += k_cell_size) {
+            const int w = 8 + static_cast<int>(rng() % (k_cell_size - 16));
+            const int h = 8 + static_cast<int>(rng() % (k_cell_size - 16));
+            const uint32_t color = static_cast<uint32_t>(rng()) | 0xffu;
+            if (rng() % 4 == 0) {
+                sheet.frame(x + 4, y + 4, w, h, 2, color);
+                sheet.fill(x + 12, y + 12, w / 4, h / 4, color);
+            } else {
+                sheet.fill(x + 4, y + 4, w, h, color);
+            }
+        }
+    }
+    return sheet;
+}
+
+template <typename Fn>
+double median_ms(int num_runs, Fn &&fn) {
+    std::vector<double> times;
+    for (int i = 0; i < num_runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int num_runs = std::max(1, argc > 1 ? std::atoi(argv[1]) : 11);
+    const tests::Sheet sheet = make_sheet();
+    const extraction::ExtractionSettings settings;
+
+    // Also a check: timing a labeller that finds other frames would mean nothing
+    std::vector<extraction::Component> components =
+        extraction::label_components(sheet.view(), settings);
+    if (!tests::same_frames(components, tests::reference_frames(sheet.view(), settings))) {
+        std::printf("labeller_benchmark: the labeller does not find the frames OpenCV finds\n");
+        return EXIT_FAILURE;
+    }
+
+    const double labeller_ms = median_ms(num_runs, [&] {
+        components = extraction::label_components(sheet.view(), settings);
+    });
+    std::vector<cv::Rect> frames;
+    const double opencv_ms =
+        median_ms(num_runs, [&] { frames = tests::reference_frames(sheet.view(), settings); });
+
+    std::printf("labeller_benchmark: %dx%d sheet, %zu sprites, median of %d runs\n",
+                k_sheet_size, k_sheet_size, components.size(), num_runs);
+    std::printf("  label_components: %8.2f ms\n", labeller_ms);
+    std::printf("  OpenCV pipeline:  %8.2f ms (cvtColor, threshold, dilate, findContours)\n",
+                opencv_ms);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+// Checks that extraction::label_components finds the same frames as the OpenCV pipeline it
+// replaced, on random sheets. Usage: labeller_test [number of sheets] [seed]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <extraction/labeller.hpp>
+#include <random>
+#include <vector>
+
+#include "extraction_reference.hpp"
+
+using namespace piksy;
+
+namespace {
+
+constexpr int k_max_failures_shown = 10;
+
+void print_failure(int sheet_index, const tests::Sheet &sheet,
+                   const extraction::ExtractionSettings &settings,
+                   const std::vector<extraction::Component> &components,
+                   const std::vector<cv::Rect> &frames) {
+    std::printf("Sheet %d (%dx%d), threshold %d, dilation %d: %zu frames, OpenCV finds %zu\n",
+                sheet_index, sheet.width, sheet.height, settings.threshold, settings.dilation,
+                components.size(), frames.size());
+    for (size_t i = 0; i < std::max(components.size(), frames.size()); ++i) {
+        if (i < components.size()) {
+            std::printf("  %3zu: (%d, %d, %d, %d)", i, components[i].x, components[i].y,
+                        components[i].w, components[i].h);
+        } else {
+            std::printf("  %3zu: -", i);
+        }
+        if (i < frames.size()) {
+            std::printf("  OpenCV (%d, %d, %d, %d)\n", frames[i].x, frames[i].y, frames[i].width,
+                        frames[i].height);
+        } else {
+            std::printf("  OpenCV -\n");
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int num_sheets = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const unsigned seed = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 7u;
+    std::mt19937 rng(seed);
+
+    int num_checks = 0;
+    int num_failures = 0;
+    for (int i = 0; i < num_sheets; ++i) {
+        // Small sheets keep shapes dense enough to touch, merge and nest
+        const int width = 1 + static_cast<int>(rng() % 160);
+        const int height = 1 + static_cast<int>(rng() % 160);
+        const tests::Sheet sheet = tests::random_sheet(rng, width, height);
+
+        const int random_threshold = static_cast<int>(rng() % 201);
+        for (int threshold : {0, 1, 2, random_threshold}) {
+            for (int dilation = 0; dilation <= 6; ++dilation) {
+                const extraction::ExtractionSettings settings{threshold, dilation};
+                std::vector<extraction::Component> components =
+                    extraction::label_components(sheet.view(), settings);
+                std::vector<cv::Rect> frames = tests::reference_frames(sheet.view(), settings);
+
+                ++num_checks;
+                if (tests::same_frames(components, frames)) continue;
+                if (++num_failures <= k_max_failures_shown) {
+                    print_failure(i, sheet, settings, components, frames);
+                }
+            }
+        }
+    }
+
+    std::printf("labeller_test: %d/%d checks match OpenCV (%d sheets, seed %u)\n",
+                num_checks - num_failures, num_checks, num_sheets, seed);
+    return num_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}